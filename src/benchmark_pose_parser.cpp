@@ -0,0 +1,215 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Throughput of text pose parsers: the std::stringstream based
+    parser, which was used originally, versus TextPoseSource.
+*/
+
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+#include <osg/Quat>
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+#include "pose_sources.h"
+
+void usage()
+{
+    printf("Options:\n");
+    printf("    -i 'text data file' (optional, a synthetic file is generated otherwise)\n");
+    printf("    -b number of bodies (default 40)\n");
+    printf("    -f number of frames in a synthetic file (default 20000)\n");
+}
+
+
+/**
+ * @brief Original parser: a new std::stringstream per line.
+ */
+class StringStreamPoseSource
+{
+    public:
+        std::ifstream   file_stream_;
+
+
+    public:
+        StringStreamPoseSource(const std::string & data_file)
+        {
+            file_stream_.open(data_file.c_str());
+        }
+
+
+        bool readFrame(std::vector<double> & poses)
+        {
+            std::string       line;
+
+            if (getline(file_stream_, line))
+            {
+                std::stringstream stream;
+
+                stream.str(line);
+                stream.clear();
+
+                for (std::size_t i = 0; i < poses.size(); ++i)
+                {
+                    stream >> poses[i];
+                }
+                return (true);
+            }
+            return (false);
+        }
+};
+
+
+struct BenchmarkResult
+{
+    std::size_t         frames_;
+    double              seconds_;
+    std::vector<double> checksum_;
+};
+
+
+template<class t_Source>
+    BenchmarkResult runBenchmark(const std::string & data_file, const std::size_t body_number)
+{
+    BenchmarkResult     result;
+    t_Source            source(data_file);
+    std::vector<double> poses(body_number * 6);
+
+    result.frames_ = 0;
+    result.checksum_.assign(poses.size(), 0.0);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (source.readFrame(poses))
+    {
+        for (std::size_t i = 0; i < poses.size(); ++i)
+        {
+            result.checksum_[i] += poses[i];
+        }
+        ++result.frames_;
+    }
+    result.seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return (result);
+}
+
+
+void reportResult(  const std::string & name,
+                    const BenchmarkResult & result,
+                    const double file_size)
+{
+    std::cout << std::setw(16) << std::left << name << std::right
+              << std::fixed << std::setprecision(1)
+              << std::setw(10) << file_size / result.seconds_ / (1024*1024) << " MB/s"
+              << std::setw(12) << result.frames_ / result.seconds_ << " frames/s"
+              << std::setw(10) << std::setprecision(3) << result.seconds_ << " s"
+              << std::endl;
+}
+
+
+int main(int argc, char **argv)
+{
+    int option;
+
+    std::string data_file;
+    std::size_t body_number = 40;
+    std::size_t frame_number = 20000;
+
+    while ((option = getopt(argc, argv, "i:b:f:")) != -1)
+    {
+        switch (option)
+        {
+            case 'i':
+                data_file = optarg;
+                break;
+            case 'b':
+                body_number = strtol(optarg, NULL, 10);
+                break;
+            case 'f':
+                frame_number = strtol(optarg, NULL, 10);
+                break;
+            case '?':
+            default:
+                usage();
+                return(0);
+        }
+    }
+
+
+    try
+    {
+        bool remove_data_file = false;
+
+        if (data_file.empty())
+        {
+            char filename[] = "/tmp/osg-robot-visualizer-benchmark-XXXXXX";
+            int fd = mkstemp(filename);
+            if (fd < 0)
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot create a temporary file.");
+            }
+            close(fd);
+            data_file = filename;
+            remove_data_file = true;
+
+            std::ofstream output(data_file.c_str());
+            output << std::setprecision(9);
+            for (std::size_t i = 0; i < frame_number; ++i)
+            {
+                for (std::size_t j = 0; j < body_number * 6; ++j)
+                {
+                    output << (j == 0 ? "" : " ") << std::sin(0.001 * i + j) * (j % 6 < 3 ? 1.5 : 3.14);
+                }
+                output << "\n";
+            }
+        }
+
+
+        std::ifstream file_size_check(data_file.c_str(), std::ios::binary | std::ios::ate);
+        double file_size = file_size_check.tellg();
+
+        BenchmarkResult reference = runBenchmark<StringStreamPoseSource>(data_file, body_number);
+        BenchmarkResult scanner = runBenchmark<TextPoseSource>(data_file, body_number);
+
+        if (remove_data_file)
+        {
+            unlink(data_file.c_str());
+        }
+
+
+        double max_difference = 0.0;
+        for (std::size_t i = 0; i < reference.checksum_.size(); ++i)
+        {
+            max_difference = std::max(max_difference, std::fabs(reference.checksum_[i] - scanner.checksum_[i]));
+        }
+
+        std::cout << "File: " << data_file << " (" << file_size / (1024*1024) << " MB, "
+                  << body_number << " bodies)" << std::endl;
+        reportResult("stringstream", reference, file_size);
+        reportResult("TextScanner", scanner, file_size);
+        std::cout << "Speedup: " << std::setprecision(2) << reference.seconds_ / scanner.seconds_
+                  << ", max checksum difference: " << std::scientific << max_difference << std::endl;
+
+        if (reference.frames_ != scanner.frames_)
+        {
+            throw std::runtime_error(std::string("In ") + __func__ + "() // Parsers read different numbers of frames.");
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << std::endl;
+        return (1);
+    }
+
+    return 0;
+}
@@ -0,0 +1,342 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Microbenchmarks of the data and scene update paths on synthetic
+    inputs, no display is needed.
+*/
+
+#include <osg/Node>
+#include <osg/Group>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Texture2D>
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+#include <osgViewer/Viewer>
+#include <osg/PositionAttitudeTransform>
+#include <osgGA/GUIEventHandler>
+#include <osgUtil/Optimizer>
+#include <osgUtil/Simplifier>
+#include <osg/LOD>
+#include <osg/Camera>
+#include <osg/Viewport>
+#include <osg/GraphicsContext>
+#include <osg/BufferObject>
+#include <osg/GLExtensions>
+#include <osg/ShapeDrawable>
+#include <osg/LineWidth>
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+
+#include "image_writers.h"
+#include "tools.h"
+#include "drawing_functions.h"
+#include "pose_sources.h"
+#include "shape_data.h"
+#include "configuration.h"
+#include "mesh_cache.h"
+#include "scene_cache.h"
+#include "level_of_detail.h"
+#include "robots.h"
+
+void usage()
+{
+    printf("Options:\n");
+    printf("    -b number of bodies (default 40)\n");
+    printf("    -f number of frames (default 20000)\n");
+    printf("    -s number of shapes of each type (default 1000)\n");
+    printf("    -r number of repetitions of shape construction (default 10)\n");
+}
+
+
+/**
+ * @brief Measures a function, which performs the given number of operations.
+ */
+class Benchmark
+{
+    protected:
+        typedef std::chrono::steady_clock   Clock;
+
+        Clock::time_point   start_;
+
+
+    public:
+        /// prevents elimination of the benchmarked code
+        double              checksum_;
+
+
+    public:
+        Benchmark()
+        {
+            checksum_ = 0.0;
+        }
+
+
+        void start()
+        {
+            start_ = Clock::now();
+        }
+
+
+        void stop(const std::string & name, const std::size_t operations, const std::string & unit)
+        {
+            const double seconds = std::chrono::duration<double>(Clock::now() - start_).count();
+
+            std::cout << std::setw(32) << std::left << name << std::right
+                      << std::fixed << std::setprecision(1)
+                      << std::setw(14) << operations / seconds << " " << std::setw(8) << std::left << (unit + "/s") << std::right
+                      << std::setw(12) << std::setprecision(3) << seconds * 1e9 / operations << " ns/" << unit
+                      << std::setw(10) << std::setprecision(3) << seconds << " s"
+                      << std::endl;
+        }
+};
+
+
+/**
+ * @brief A robot with bodies without meshes, which reads the given file.
+ */
+osg::ref_ptr<Robot> createSyntheticRobot(   const std::size_t body_number,
+                                            const std::string & data_file)
+{
+    osg::ref_ptr<Robot> robot = new Robot;
+
+    robot->robot_group_ = new osg::Group;
+    for (std::size_t i = 0; i < body_number; ++i)
+    {
+        osg::ref_ptr<osg::PositionAttitudeTransform> body = new osg::PositionAttitudeTransform;
+        body->setName("body" + std::to_string(i));
+
+        robot->robot_group_->addChild(body.get());
+        robot->robot_data_->addBody(body);
+        robot->body_names_.push_back(body->getName());
+    }
+
+    robot->poses_.resize(body_number * 6);
+    robot->pose_source_ = createPoseSource(data_file, robot->body_names_);
+
+    return (robot);
+}
+
+
+double getSyntheticValue(const std::size_t frame, const std::size_t value)
+{
+    return (std::sin(0.001 * frame + value) * (value % 6 < 3 ? 1.5 : 3.14));
+}
+
+
+int main(int argc, char **argv)
+{
+    int option;
+
+    std::size_t body_number = 40;
+    std::size_t frame_number = 20000;
+    std::size_t shape_number = 1000;
+    std::size_t repetition_number = 10;
+
+    while ((option = getopt(argc, argv, "b:f:s:r:")) != -1)
+    {
+        switch (option)
+        {
+            case 'b':
+                body_number = strtol(optarg, NULL, 10);
+                break;
+            case 'f':
+                frame_number = strtol(optarg, NULL, 10);
+                break;
+            case 's':
+                shape_number = strtol(optarg, NULL, 10);
+                break;
+            case 'r':
+                repetition_number = strtol(optarg, NULL, 10);
+                break;
+            case '?':
+            default:
+                usage();
+                return(0);
+        }
+    }
+
+
+    try
+    {
+        if ((0 == body_number) || (0 == frame_number) || (0 == shape_number) || (0 == repetition_number))
+        {
+            throw std::runtime_error(std::string("In ") + __func__ + "() // Sizes must be positive.");
+        }
+
+        std::cout << body_number << " bodies, " << frame_number << " frames, "
+                  << shape_number << " shapes of each type, " << repetition_number << " repetitions" << std::endl;
+
+        Benchmark benchmark;
+
+
+        // data file
+        char filename[] = "/tmp/osg-robot-visualizer-benchmark-XXXXXX";
+        int fd = mkstemp(filename);
+        if (fd < 0)
+        {
+            throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot create a temporary file.");
+        }
+        close(fd);
+        const std::string data_file = filename;
+        {
+            std::ofstream output(data_file.c_str());
+            output << std::setprecision(9);
+            for (std::size_t i = 0; i < frame_number; ++i)
+            {
+                for (std::size_t j = 0; j < body_number * 6; ++j)
+                {
+                    output << (j == 0 ? "" : " ") << getSyntheticValue(i, j);
+                }
+                output << "\n";
+            }
+        }
+
+
+        // Robot::readStates(): parsing and setBodyState()
+        {
+            osg::ref_ptr<Robot> robot = createSyntheticRobot(body_number, data_file);
+
+            benchmark.start();
+            for (std::size_t i = 0; i < frame_number; ++i)
+            {
+                robot->readStates();
+            }
+            benchmark.stop("Robot::readStates", frame_number, "frame");
+
+            benchmark.checksum_ += robot->robot_data_->positions_[0].x();
+        }
+        unlink(data_file.c_str());
+
+
+        // synthetic poses in memory
+        std::vector<osg::Vec3> positions(frame_number * body_number);
+        std::vector<osg::Vec3> rpys(frame_number * body_number);
+        for (std::size_t i = 0; i < frame_number; ++i)
+        {
+            for (std::size_t j = 0; j < body_number; ++j)
+            {
+                positions[i * body_number + j] = osg::Vec3(getSyntheticValue(i, j * 6),
+                                                           getSyntheticValue(i, j * 6 + 1),
+                                                           getSyntheticValue(i, j * 6 + 2));
+                rpys[i * body_number + j] = osg::Vec3(getSyntheticValue(i, j * 6 + 3),
+                                                      getSyntheticValue(i, j * 6 + 4),
+                                                      getSyntheticValue(i, j * 6 + 5));
+            }
+        }
+
+
+        // convertRPYtoQuaternion()
+        {
+            benchmark.start();
+            for (std::size_t i = 0; i < rpys.size(); ++i)
+            {
+                benchmark.checksum_ += convertRPYtoQuaternion(rpys[i]).w();
+            }
+            benchmark.stop("convertRPYtoQuaternion", rpys.size(), "body");
+        }
+
+
+        // robotDataType
+        {
+            osg::ref_ptr<Robot> robot = createSyntheticRobot(body_number, "/dev/null");
+            robotDataType & robot_data = *robot->robot_data_;
+
+            benchmark.start();
+            for (std::size_t i = 0; i < frame_number; ++i)
+            {
+                for (std::size_t j = 0; j < body_number; ++j)
+                {
+                    robot_data.setBodyState(j, positions[i * body_number + j], rpys[i * body_number + j]);
+                }
+            }
+            benchmark.stop("robotDataType::setBodyState", frame_number * body_number, "body");
+
+            benchmark.start();
+            for (std::size_t i = 0; i < frame_number; ++i)
+            {
+                robot_data.updated_ = true;
+                robot_data.updateRobotState();
+            }
+            benchmark.stop("robotDataType::updateRobotState", frame_number, "frame");
+
+            benchmark.checksum_ += robot_data.body_transforms_[0]->getPosition().x();
+        }
+
+
+        // construction of shapes
+        {
+            const osg::Vec4 color(1., 0., 0., 1.);
+            std::size_t child_number = 0;
+
+            benchmark.start();
+            for (std::size_t i = 0; i < repetition_number; ++i)
+            {
+                osg::ref_ptr<osg::Group> group = new osg::Group;
+                for (std::size_t j = 0; j < shape_number; ++j)
+                {
+                    drawBox(group, positions[j % positions.size()], rpys[j % rpys.size()], osg::Vec3(0.1, 0.2, 0.3), color);
+                }
+                child_number += group->getNumChildren();
+            }
+            benchmark.stop("drawBox", repetition_number * shape_number, "shape");
+
+            benchmark.start();
+            for (std::size_t i = 0; i < repetition_number; ++i)
+            {
+                osg::ref_ptr<osg::Group> group = new osg::Group;
+                for (std::size_t j = 0; j < shape_number; ++j)
+                {
+                    drawArrow(group, positions[j % positions.size()], rpys[j % rpys.size()], color);
+                }
+                child_number += group->getNumChildren();
+            }
+            benchmark.stop("drawArrow", repetition_number * shape_number, "shape");
+
+            benchmark.start();
+            for (std::size_t i = 0; i < repetition_number; ++i)
+            {
+                osg::ref_ptr<osg::Group> group = new osg::Group;
+                for (std::size_t j = 0; j < shape_number; ++j)
+                {
+                    drawSphere(group, positions[j % positions.size()], 0.1, color);
+                }
+                child_number += group->getNumChildren();
+            }
+            benchmark.stop("drawSphere", repetition_number * shape_number, "shape");
+
+            benchmark.start();
+            for (std::size_t i = 0; i < repetition_number; ++i)
+            {
+                osg::ref_ptr<osg::Group> group = new osg::Group;
+                for (std::size_t j = 0; j < shape_number; ++j)
+                {
+                    drawCylinder(group, positions[j % positions.size()], rpys[j % rpys.size()], 0.05, 0.3, color);
+                }
+                child_number += group->getNumChildren();
+            }
+            benchmark.stop("drawCylinder", repetition_number * shape_number, "shape");
+
+            benchmark.checksum_ += child_number;
+        }
+
+        std::cout << "Checksum: " << std::scientific << benchmark.checksum_ << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << std::endl;
+        return (1);
+    }
+
+    return 0;
+}
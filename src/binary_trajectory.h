@@ -0,0 +1,367 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Fixed-stride binary trajectory format.
+
+    Layout of a file (native byte order):
+        1. BinaryTrajectoryHeader;
+        2. names of the bodies, each terminated with '\0';
+        3. zero padding up to BinaryTrajectoryHeader::data_offset_;
+        4. frame_number_ records, each containing body_number_ XYZ-RPY
+           vectors (6 scalars per body) stored as float or double.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+
+#define BINARY_TRAJECTORY_MAGIC     "ORVPOSE"
+#define BINARY_TRAJECTORY_VERSION   1
+#define BINARY_TRAJECTORY_ALIGNMENT 64
+
+
+struct BinaryTrajectoryHeader
+{
+    char        magic_[8];
+    uint32_t    version_;
+    uint32_t    scalar_size_;
+    uint64_t    body_number_;
+    uint64_t    frame_number_;
+    uint64_t    data_offset_;
+
+
+    BinaryTrajectoryHeader()
+    {
+        memset(this, 0, sizeof(BinaryTrajectoryHeader));
+        memcpy(magic_, BINARY_TRAJECTORY_MAGIC, sizeof(BINARY_TRAJECTORY_MAGIC));
+        version_ = BINARY_TRAJECTORY_VERSION;
+    }
+
+
+    bool isValid() const
+    {
+        return ( (0 == memcmp(magic_, BINARY_TRAJECTORY_MAGIC, sizeof(BINARY_TRAJECTORY_MAGIC)))
+                && (BINARY_TRAJECTORY_VERSION == version_)
+                && ((sizeof(float) == scalar_size_) || (sizeof(double) == scalar_size_))
+                && (body_number_ > 0)
+                && (data_offset_ >= sizeof(BinaryTrajectoryHeader))
+                // each body name takes at least one byte, which also
+                // prevents overflow in getFrameSize()
+                && (body_number_ <= data_offset_ - sizeof(BinaryTrajectoryHeader))
+                && (0 == data_offset_ % sizeof(double)));
+    }
+
+
+    std::size_t getFrameSize() const
+    {
+        return (body_number_ * 6 * scalar_size_);
+    }
+};
+
+
+
+/**
+ * @brief Checks if a file starts with a binary trajectory header.
+ */
+bool isBinaryTrajectoryFile(const std::string & filename)
+{
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    char magic[sizeof(BINARY_TRAJECTORY_MAGIC)];
+
+    if (file.read(magic, sizeof(magic)))
+    {
+        return (0 == memcmp(magic, BINARY_TRAJECTORY_MAGIC, sizeof(BINARY_TRAJECTORY_MAGIC)));
+    }
+    return (false);
+}
+
+
+
+/**
+ * @brief Returns indices of the given bodies in the list of bodies stored
+ * in a trajectory file.
+ */
+std::vector<std::size_t> getTrajectoryColumns( const std::vector<std::string> & file_body_names,
+                                                const std::vector<std::string> & body_names)
+{
+    std::vector<std::size_t> columns;
+
+    for (std::size_t i = 0; i < body_names.size(); ++i)
+    {
+        std::size_t j = 0;
+        for (; j < file_body_names.size(); ++j)
+        {
+            if (body_names[i] == file_body_names[j])
+            {
+                break;
+            }
+        }
+
+        if (file_body_names.size() == j)
+        {
+            throw std::runtime_error(std::string("In ") + __func__ + "() // Body is missing in trajectory file: " + body_names[i]);
+        }
+        columns.push_back(j);
+    }
+
+    return (columns);
+}
+
+
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ */
+class MemoryMappedFile
+{
+    private:
+        MemoryMappedFile(const MemoryMappedFile &);
+        MemoryMappedFile & operator=(const MemoryMappedFile &);
+
+
+    public:
+        const char *    data_;
+        std::size_t     size_;
+
+
+    public:
+        MemoryMappedFile(const std::string & filename)
+        {
+            int fd = open(filename.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot open file: " + filename);
+            }
+
+            struct stat file_stat;
+            if (fstat(fd, &file_stat) < 0)
+            {
+                close(fd);
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot stat file: " + filename);
+            }
+            size_ = file_stat.st_size;
+
+            void * data = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+
+            if (MAP_FAILED == data)
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot map file: " + filename);
+            }
+            // frames are replayed in order
+            madvise(data, size_, MADV_SEQUENTIAL);
+
+            data_ = static_cast<const char *>(data);
+        }
+
+
+        ~MemoryMappedFile()
+        {
+            munmap(const_cast<char *>(data_), size_);
+        }
+};
+
+
+
+/**
+ * @brief Zero-copy view of a memory mapped binary trajectory file.
+ */
+class BinaryTrajectoryFile
+{
+    protected:
+        template<typename t_Scalar>
+            void readFrameTemplate( const std::size_t frame_index,
+                                    const std::vector<std::size_t> & columns,
+                                    double * poses) const
+        {
+            const t_Scalar * record = reinterpret_cast<const t_Scalar *>(
+                    file_.data_ + header_->data_offset_ + frame_index * header_->getFrameSize());
+
+            for (std::size_t i = 0; i < columns.size(); ++i)
+            {
+                const t_Scalar * body_pose = record + columns[i] * 6;
+                for (std::size_t j = 0; j < 6; ++j)
+                {
+                    poses[i*6 + j] = body_pose[j];
+                }
+            }
+        }
+
+
+    public:
+        MemoryMappedFile                file_;
+        const BinaryTrajectoryHeader *  header_;
+        std::vector<std::string>        body_names_;
+
+
+    public:
+        BinaryTrajectoryFile(const std::string & filename) : file_(filename)
+        {
+            header_ = reinterpret_cast<const BinaryTrajectoryHeader *>(file_.data_);
+
+            if ((file_.size_ < sizeof(BinaryTrajectoryHeader)) || (!header_->isValid()))
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Wrong header in binary trajectory file: " + filename);
+            }
+
+            if ((header_->data_offset_ > file_.size_)
+                    || (header_->frame_number_ > (file_.size_ - header_->data_offset_) / header_->getFrameSize()))
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Truncated binary trajectory file: " + filename);
+            }
+
+
+            const char * name = file_.data_ + sizeof(BinaryTrajectoryHeader);
+            const char * names_end = file_.data_ + header_->data_offset_;
+            for (std::size_t i = 0; i < header_->body_number_; ++i)
+            {
+                const char * name_end = static_cast<const char *>(memchr(name, '\0', names_end - name));
+                if (NULL == name_end)
+                {
+                    throw std::runtime_error(std::string("In ") + __func__ + "() // Wrong body names in binary trajectory file: " + filename);
+                }
+                body_names_.push_back(std::string(name, name_end));
+                name = name_end + 1;
+            }
+        }
+
+
+        /**
+         * @brief Returns column indices of the given bodies in the file.
+         */
+        std::vector<std::size_t> getColumns(const std::vector<std::string> & body_names) const
+        {
+            return (getTrajectoryColumns(body_names_, body_names));
+        }
+
+
+        /**
+         * @brief Copies poses of the selected bodies directly from the mapping.
+         *
+         * @param[in] frame_index
+         * @param[in] columns   see getColumns()
+         * @param[out] poses    6 values per column
+         */
+        void readFrame( const std::size_t frame_index,
+                        const std::vector<std::size_t> & columns,
+                        double * poses) const
+        {
+            if (sizeof(float) == header_->scalar_size_)
+            {
+                readFrameTemplate<float>(frame_index, columns, poses);
+            }
+            else
+            {
+                readFrameTemplate<double>(frame_index, columns, poses);
+            }
+        }
+};
+
+
+
+/**
+ * @brief Writes binary trajectory files, frame count is filled in on close().
+ */
+class BinaryTrajectoryWriter
+{
+    protected:
+        template<typename t_Scalar>
+            void writeFrameTemplate(const std::vector<double> & poses)
+        {
+            buffer_.resize(poses.size() * sizeof(t_Scalar));
+            t_Scalar * record = reinterpret_cast<t_Scalar *>(&buffer_[0]);
+
+            for (std::size_t i = 0; i < poses.size(); ++i)
+            {
+                record[i] = poses[i];
+            }
+            file_stream_.write(&buffer_[0], buffer_.size());
+        }
+
+
+    public:
+        std::ofstream           file_stream_;
+        BinaryTrajectoryHeader  header_;
+        std::vector<char>       buffer_;
+
+
+    public:
+        BinaryTrajectoryWriter( const std::string & filename,
+                                const std::vector<std::string> & body_names,
+                                const bool use_float)
+        {
+            header_.scalar_size_ = use_float ? sizeof(float) : sizeof(double);
+            header_.body_number_ = body_names.size();
+
+            std::size_t names_size = 0;
+            for (std::size_t i = 0; i < body_names.size(); ++i)
+            {
+                names_size += body_names[i].size() + 1;
+            }
+            header_.data_offset_ = sizeof(BinaryTrajectoryHeader) + names_size;
+            header_.data_offset_ += (BINARY_TRAJECTORY_ALIGNMENT - header_.data_offset_ % BINARY_TRAJECTORY_ALIGNMENT)
+                                    % BINARY_TRAJECTORY_ALIGNMENT;
+
+
+            file_stream_.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+            if (file_stream_.fail())
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot open output file: " + filename);
+            }
+
+            file_stream_.write(reinterpret_cast<const char *>(&header_), sizeof(BinaryTrajectoryHeader));
+            for (std::size_t i = 0; i < body_names.size(); ++i)
+            {
+                file_stream_.write(body_names[i].c_str(), body_names[i].size() + 1);
+            }
+            std::vector<char> padding(header_.data_offset_ - sizeof(BinaryTrajectoryHeader) - names_size, '\0');
+            file_stream_.write(padding.data(), padding.size());
+        }
+
+
+        void writeFrame(const std::vector<double> & poses)
+        {
+            if (poses.size() != header_.body_number_ * 6)
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Wrong number of values in a frame.");
+            }
+
+            if (sizeof(float) == header_.scalar_size_)
+            {
+                writeFrameTemplate<float>(poses);
+            }
+            else
+            {
+                writeFrameTemplate<double>(poses);
+            }
+            ++header_.frame_number_;
+        }
+
+
+        void close()
+        {
+            file_stream_.seekp(0);
+            file_stream_.write(reinterpret_cast<const char *>(&header_), sizeof(BinaryTrajectoryHeader));
+            file_stream_.close();
+
+            if (file_stream_.fail())
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Failed to write output file.");
+            }
+        }
+};
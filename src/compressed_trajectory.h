@@ -0,0 +1,386 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Chunked compressed trajectory format.
+
+    Values are quantized with a fixed step (precision_), i.e., stored as
+    integers q = round(value / precision_), and each frame is encoded as
+    differences with the previous frame of the same chunk, so that the first
+    frame of a chunk is stored as is. Differences are written as zigzag
+    varints: small differences of slowly changing poses take one byte. Chunks
+    are independent, which allows seeking and parallel decoding.
+
+    Layout of a file (native byte order):
+        1. CompressedTrajectoryHeader;
+        2. names of the bodies, each terminated with '\0';
+        3. chunks of chunk_size_ frames (the last one may be shorter), each
+           frame contains body_number_ XYZ-RPY vectors (6 values per body);
+        4. chunk index at index_offset_: offset and size of each chunk.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include "binary_trajectory.h"
+
+
+#define COMPRESSED_TRAJECTORY_MAGIC     "ORVCPOS"
+#define COMPRESSED_TRAJECTORY_VERSION   1
+#define COMPRESSED_TRAJECTORY_CHUNK_SIZE 256
+/// bound of quantized values, leaves room for differences
+#define COMPRESSED_TRAJECTORY_MAX_QUANTIZED 4000000000000000000LL
+
+
+struct CompressedTrajectoryHeader
+{
+    char        magic_[8];
+    uint32_t    version_;
+    /// number of frames in a chunk
+    uint32_t    chunk_size_;
+    uint64_t    body_number_;
+    uint64_t    frame_number_;
+    /// quantization step
+    double      precision_;
+    uint64_t    index_offset_;
+
+
+    CompressedTrajectoryHeader()
+    {
+        memset(this, 0, sizeof(CompressedTrajectoryHeader));
+        memcpy(magic_, COMPRESSED_TRAJECTORY_MAGIC, sizeof(COMPRESSED_TRAJECTORY_MAGIC));
+        version_ = COMPRESSED_TRAJECTORY_VERSION;
+    }
+
+
+    bool isValid() const
+    {
+        return ( (0 == memcmp(magic_, COMPRESSED_TRAJECTORY_MAGIC, sizeof(COMPRESSED_TRAJECTORY_MAGIC)))
+                && (COMPRESSED_TRAJECTORY_VERSION == version_)
+                && (chunk_size_ > 0)
+                && (body_number_ > 0)
+                && (frame_number_ <= UINT64_MAX - chunk_size_)
+                && (precision_ > 0.0)
+                && (index_offset_ >= sizeof(CompressedTrajectoryHeader)));
+    }
+
+
+    std::size_t getChunkNumber() const
+    {
+        return ((frame_number_ + chunk_size_ - 1) / chunk_size_);
+    }
+
+
+    std::size_t getFrameSize() const
+    {
+        return (body_number_ * 6);
+    }
+};
+
+
+struct CompressedTrajectoryChunk
+{
+    uint64_t    offset_;
+    uint64_t    size_;
+};
+
+
+
+/**
+ * @brief Checks if a file starts with a compressed trajectory header.
+ */
+bool isCompressedTrajectoryFile(const std::string & filename)
+{
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    char magic[sizeof(COMPRESSED_TRAJECTORY_MAGIC)];
+
+    if (file.read(magic, sizeof(magic)))
+    {
+        return (0 == memcmp(magic, COMPRESSED_TRAJECTORY_MAGIC, sizeof(COMPRESSED_TRAJECTORY_MAGIC)));
+    }
+    return (false);
+}
+
+
+
+/**
+ * @brief Memory mapped compressed trajectory file, chunks are decoded on
+ * request, the methods are safe to call from multiple threads.
+ */
+class CompressedTrajectoryFile
+{
+    public:
+        MemoryMappedFile                    file_;
+        const CompressedTrajectoryHeader *  header_;
+        const CompressedTrajectoryChunk *   chunks_;
+        std::vector<std::string>            body_names_;
+
+
+    public:
+        CompressedTrajectoryFile(const std::string & filename) : file_(filename)
+        {
+            header_ = reinterpret_cast<const CompressedTrajectoryHeader *>(file_.data_);
+
+            if ((file_.size_ < sizeof(CompressedTrajectoryHeader)) || (!header_->isValid()))
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Wrong header in compressed trajectory file: " + filename);
+            }
+
+            if ((header_->index_offset_ > file_.size_)
+                    || (0 != header_->index_offset_ % sizeof(uint64_t))
+                    || (header_->getChunkNumber() > (file_.size_ - header_->index_offset_) / sizeof(CompressedTrajectoryChunk)))
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Truncated compressed trajectory file: " + filename);
+            }
+            chunks_ = reinterpret_cast<const CompressedTrajectoryChunk *>(file_.data_ + header_->index_offset_);
+
+
+            const char * name = file_.data_ + sizeof(CompressedTrajectoryHeader);
+            const char * names_end = file_.data_ + header_->index_offset_;
+            for (std::size_t i = 0; i < header_->body_number_; ++i)
+            {
+                const char * name_end = static_cast<const char *>(memchr(name, '\0', names_end - name));
+                if (NULL == name_end)
+                {
+                    throw std::runtime_error(std::string("In ") + __func__ + "() // Wrong body names in compressed trajectory file: " + filename);
+                }
+                body_names_.push_back(std::string(name, name_end));
+                name = name_end + 1;
+            }
+
+
+            // chunks lie between the names and the index
+            const uint64_t data_offset = name - file_.data_;
+            for (std::size_t i = 0; i < header_->getChunkNumber(); ++i)
+            {
+                if ((chunks_[i].offset_ < data_offset)
+                        || (chunks_[i].offset_ > header_->index_offset_)
+                        || (chunks_[i].size_ > header_->index_offset_ - chunks_[i].offset_))
+                {
+                    throw std::runtime_error(std::string("In ") + __func__ + "() // Wrong chunk index in compressed trajectory file: " + filename);
+                }
+            }
+        }
+
+
+        std::vector<std::size_t> getColumns(const std::vector<std::string> & body_names) const
+        {
+            return (getTrajectoryColumns(body_names_, body_names));
+        }
+
+
+        std::size_t getChunkFrameNumber(const std::size_t chunk_index) const
+        {
+            return (std::min(static_cast<std::size_t>(header_->chunk_size_),
+                             static_cast<std::size_t>(header_->frame_number_ - chunk_index * header_->chunk_size_)));
+        }
+
+
+        /**
+         * @brief Decodes all frames of a chunk.
+         *
+         * @param[in] chunk_index
+         * @param[out] frames   getChunkFrameNumber() frames of all bodies
+         */
+        void decodeChunk(const std::size_t chunk_index, std::vector<double> & frames) const
+        {
+            const std::size_t frame_size = header_->getFrameSize();
+            const std::size_t value_number = getChunkFrameNumber(chunk_index) * frame_size;
+
+            const uint8_t * data = reinterpret_cast<const uint8_t *>(file_.data_ + chunks_[chunk_index].offset_);
+            const uint8_t * data_end = data + chunks_[chunk_index].size_;
+
+            // unsigned arithmetic wraps around on corrupted deltas, the
+            // values are validated after decoding
+            std::vector<uint64_t> previous(frame_size, 0);
+            frames.resize(value_number);
+
+            for (std::size_t i = 0; i < value_number; i += frame_size)
+            {
+                for (std::size_t j = 0; j < frame_size; ++j)
+                {
+                    // zigzag varint
+                    uint64_t encoded = 0;
+                    for (unsigned int shift = 0; ; shift += 7)
+                    {
+                        if ((data == data_end) || (shift > 63))
+                        {
+                            throw std::runtime_error(std::string("In ") + __func__ + "() // Corrupted chunk in compressed trajectory file.");
+                        }
+
+                        encoded |= static_cast<uint64_t>(*data & 0x7f) << shift;
+                        if (0 == (*data++ & 0x80))
+                        {
+                            break;
+                        }
+                    }
+
+                    previous[j] += (encoded >> 1) ^ (0 - (encoded & 1));
+
+                    const int64_t value = static_cast<int64_t>(previous[j]);
+                    if ((value >= COMPRESSED_TRAJECTORY_MAX_QUANTIZED) || (value <= -COMPRESSED_TRAJECTORY_MAX_QUANTIZED))
+                    {
+                        throw std::runtime_error(std::string("In ") + __func__ + "() // Corrupted chunk in compressed trajectory file.");
+                    }
+                    frames[i + j] = value * header_->precision_;
+                }
+            }
+        }
+};
+
+
+
+/**
+ * @brief Writes compressed trajectory files, the chunk index and the frame
+ * count are written on close().
+ */
+class CompressedTrajectoryWriter
+{
+    protected:
+        void writeChunk()
+        {
+            if (0 == chunk_frame_number_)
+            {
+                return;
+            }
+
+            CompressedTrajectoryChunk chunk;
+            chunk.offset_ = file_stream_.tellp();
+            chunk.size_ = buffer_.size();
+            chunks_.push_back(chunk);
+
+            file_stream_.write(reinterpret_cast<const char *>(buffer_.data()), buffer_.size());
+
+            buffer_.clear();
+            chunk_frame_number_ = 0;
+            std::fill(previous_.begin(), previous_.end(), 0);
+        }
+
+
+    public:
+        std::ofstream                           file_stream_;
+        CompressedTrajectoryHeader              header_;
+        std::vector<CompressedTrajectoryChunk>  chunks_;
+
+        /// encoded frames of the current chunk
+        std::vector<uint8_t>                    buffer_;
+        std::size_t                             chunk_frame_number_;
+        /// quantized values of the previous frame
+        std::vector<int64_t>                    previous_;
+
+
+    public:
+        /**
+         * @param[in] filename
+         * @param[in] body_names
+         * @param[in] precision     quantization step, e.g., 1e-5 (m and rad)
+         * @param[in] chunk_size    number of frames in a chunk
+         */
+        CompressedTrajectoryWriter( const std::string & filename,
+                                    const std::vector<std::string> & body_names,
+                                    const double precision,
+                                    const std::size_t chunk_size = COMPRESSED_TRAJECTORY_CHUNK_SIZE)
+        {
+            if ((precision <= 0.0) || (0 == chunk_size))
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Precision and chunk size must be positive.");
+            }
+
+            header_.chunk_size_ = chunk_size;
+            header_.body_number_ = body_names.size();
+            header_.precision_ = precision;
+
+            chunk_frame_number_ = 0;
+            previous_.resize(header_.getFrameSize(), 0);
+
+
+            file_stream_.open(filename.c_str(), std::ios::binary | std::ios::trunc);
+            if (file_stream_.fail())
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot open output file: " + filename);
+            }
+
+            file_stream_.write(reinterpret_cast<const char *>(&header_), sizeof(CompressedTrajectoryHeader));
+            for (std::size_t i = 0; i < body_names.size(); ++i)
+            {
+                file_stream_.write(body_names[i].c_str(), body_names[i].size() + 1);
+            }
+        }
+
+
+        void writeFrame(const std::vector<double> & poses)
+        {
+            if (poses.size() != header_.getFrameSize())
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Wrong number of values in a frame.");
+            }
+
+            for (std::size_t i = 0; i < poses.size(); ++i)
+            {
+                const double quantized = std::round(poses[i] / header_.precision_);
+                if (!(std::fabs(quantized) < COMPRESSED_TRAJECTORY_MAX_QUANTIZED))
+                {
+                    throw std::runtime_error(std::string("In ") + __func__ + "() // Value cannot be quantized with the given precision.");
+                }
+
+                const int64_t value = static_cast<int64_t>(quantized);
+                const int64_t delta = value - previous_[i];
+                previous_[i] = value;
+
+                // zigzag varint
+                uint64_t encoded = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+                while (encoded >= 0x80)
+                {
+                    buffer_.push_back(static_cast<uint8_t>(encoded) | 0x80);
+                    encoded >>= 7;
+                }
+                buffer_.push_back(static_cast<uint8_t>(encoded));
+            }
+
+            ++header_.frame_number_;
+            if (++chunk_frame_number_ == header_.chunk_size_)
+            {
+                writeChunk();
+            }
+        }
+
+
+        void close()
+        {
+            writeChunk();
+
+            // the index is aligned to simplify access
+            std::vector<char> padding((sizeof(uint64_t) - file_stream_.tellp() % sizeof(uint64_t)) % sizeof(uint64_t), '\0');
+            file_stream_.write(padding.data(), padding.size());
+
+            header_.index_offset_ = file_stream_.tellp();
+            file_stream_.write(reinterpret_cast<const char *>(chunks_.data()), chunks_.size() * sizeof(CompressedTrajectoryChunk));
+
+            file_stream_.seekp(0);
+            file_stream_.write(reinterpret_cast<const char *>(&header_), sizeof(CompressedTrajectoryHeader));
+            file_stream_.close();
+
+            if (file_stream_.fail())
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Failed to write output file.");
+            }
+        }
+
+
+        /// size of the file after close()
+        std::size_t getSize() const
+        {
+            return (header_.index_offset_ + chunks_.size() * sizeof(CompressedTrajectoryChunk));
+        }
+};
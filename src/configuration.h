@@ -11,6 +11,9 @@
 
 #include "yaml-cpp/yaml.h"
 
+#include <algorithm>
+#include <thread>
+
 namespace YAML
 {
     template<>
@@ -71,52 +74,213 @@ namespace YAML
 class SimpleShape : public osg::Referenced
 {
     protected:
-        void readVector(std::stringstream &stream,
-                        osg::Vec3 & vector) const
+        /**
+         * @brief Creates the subgraph of the shape, called once.
+         */
+        virtual osg::ref_ptr<osg::PositionAttitudeTransform> create() = 0;
+
+
+        /**
+         * @brief A parameter can be given as '{column: N}', in this case it
+         * is read from ShapeData starting from column N.
+         */
+        static bool readColumn(const YAML::Node & node, std::ptrdiff_t & column)
         {
-            stream >> vector.x();
-            stream >> vector.y();
-            stream >> vector.z();
+            if (node.IsMap() && node["column"])
+            {
+                column = node["column"].as<std::ptrdiff_t>();
+                return (true);
+            }
+            return (false);
+        }
+
+
+        void checkColumns(const std::ptrdiff_t column, const std::size_t number) const
+        {
+            if (column >= 0)
+            {
+                if (!shape_data_.valid())
+                {
+                    throw std::runtime_error(std::string("In ") + __func__ + "() // " + ("Shape data file is not specified."));
+                }
+                shape_data_->checkColumns(column, number);
+            }
         }
 
 
     public:
         osg::Vec3 position_;
+        /// used by shapes with orientation
+        osg::Vec3 rpy_;
 
         osg::Vec4 color_;
 
+        /// columns of animated parameters in shape_data_, -1 if constant
+        std::ptrdiff_t position_column_;
+        std::ptrdiff_t rpy_column_;
+        std::ptrdiff_t color_column_;
+        osg::ref_ptr<ShapeData> shape_data_;
+
         std::ptrdiff_t first_iter_;
         std::ptrdiff_t last_iter_;
 
+        osg::ref_ptr<osg::PositionAttitudeTransform> transform_;
+        bool visible_;
+
 
     public:
         SimpleShape()
         {
             position_ = osg::Vec3(0., 0., 0.);
+            rpy_ = osg::Vec3(0., 0., 0.);
             color_ = osg::Vec4(0., 0., 0., 1.);
+            position_column_ = -1;
+            rpy_column_ = -1;
+            color_column_ = -1;
             first_iter_ = 0;
             last_iter_ = -1;
+            visible_ = false;
         }
 
         void read(const YAML::Node & node, const std::string & path_to_config)
         {
             (void) path_to_config;
-            position_ = node["position"].as<osg::Vec3>();
-            color_ = node["color"].as<osg::Vec4>();
+            if (!readColumn(node["position"], position_column_))
+            {
+                position_ = node["position"].as<osg::Vec3>();
+            }
+            if (!readColumn(node["color"], color_column_))
+            {
+                color_ = node["color"].as<osg::Vec4>();
+            }
             first_iter_ = node["first_iter"].as<std::ptrdiff_t>();
             last_iter_ = node["last_iter"].as<std::ptrdiff_t>();
         }
 
-        virtual void draw(  osg::ref_ptr<osg::Group>,
-                            const std::ptrdiff_t) = 0;
+
+        /**
+         * @brief Adds the shape to the scene, it is hidden until it is shown
+         * by ShapeTimeline.
+         */
+        void build(osg::ref_ptr<osg::Group> group)
+        {
+            transform_ = create();
+            transform_->setNodeMask(0);
+            if (FrameProfiler::isEnabled())
+            {
+                FrameProfiler::count(FrameProfiler::NODES_ALLOCATED, countNodes(transform_));
+            }
+            visible_ = false;
+
+            group->addChild(transform_);
+        }
+
+
+        void setVisible(const bool visible)
+        {
+            if (visible != visible_)
+            {
+                transform_->setNodeMask(visible ? ~0u : 0);
+                visible_ = visible;
+            }
+        }
+
+
+        /**
+         * @brief True if the shape changes while it is visible, in this case
+         * updateVisible() is called on each iteration.
+         */
+        virtual bool isAnimated() const
+        {
+            return ((position_column_ >= 0) || (rpy_column_ >= 0) || (color_column_ >= 0));
+        }
+
+
+        /**
+         * @brief Updates parameters read from ShapeData, values are
+         * compared to avoid redundant updates of the scene.
+         */
+        virtual void updateVisible(const std::ptrdiff_t)
+        {
+            if (position_column_ >= 0)
+            {
+                const osg::Vec3 position = shape_data_->getVec3(position_column_);
+                if (position != position_)
+                {
+                    position_ = position;
+                    transform_->setPosition(position_);
+                }
+            }
+
+            if (rpy_column_ >= 0)
+            {
+                const osg::Vec3 rpy = shape_data_->getVec3(rpy_column_);
+                if (rpy != rpy_)
+                {
+                    rpy_ = rpy;
+                    transform_->setAttitude(convertRPYtoQuaternion(rpy_));
+                }
+            }
+
+            if (color_column_ >= 0)
+            {
+                const osg::Vec4 color = shape_data_->getVec4(color_column_);
+                if (color != color_)
+                {
+                    color_ = color;
+                    setShapeColor(transform_.get(), color_);
+                }
+            }
+        }
+
+
+        /**
+         * @brief Connects the shape to the scene level data file, which may
+         * be NULL if it is not specified.
+         */
+        virtual void setShapeData(osg::ref_ptr<ShapeData> shape_data)
+        {
+            shape_data_ = shape_data;
+
+            checkColumns(position_column_, 3);
+            checkColumns(rpy_column_, 3);
+            checkColumns(color_column_, 4);
+        }
+
+
+        /**
+         * @brief Enables background reading of data files used by the shape.
+         */
+        virtual void setPrefetchDepth(const std::size_t)
+        {
+        }
+
+
+        virtual void printStatistics() const
+        {
+        }
 };
 
 
 class Arrow : public SimpleShape
 {
     private:
-        std::ifstream   file_stream_;
-        bool            read_vector_from_file_;
+        std::string                 vector_file_;
+        osg::ref_ptr<PoseSource>    vector_source_;
+        std::vector<double>         vector_buffer_;
+        /// index of the line of vector_file_, which is read next
+        std::ptrdiff_t              next_frame_;
+        /// column of the vector in shape_data_, -1 if not used
+        std::ptrdiff_t              vector_column_;
+
+
+    protected:
+        osg::ref_ptr<osg::PositionAttitudeTransform> create()
+        {
+            osg::ref_ptr<osg::PositionAttitudeTransform> arrow = createArrow(color_);
+            setArrowVector(arrow, position_, vector_/vector_normalize_);
+            return (arrow);
+        }
 
 
     public:
@@ -128,6 +292,10 @@ class Arrow : public SimpleShape
         Arrow()
         {
             vector_ = osg::Vec3(0., 0., 0.);
+            vector_normalize_ = 1.0;
+            vector_buffer_.resize(3);
+            next_frame_ = 0;
+            vector_column_ = -1;
         }
 
         void read(const YAML::Node & node, const std::string & path_to_config)
@@ -139,111 +307,299 @@ class Arrow : public SimpleShape
             if (node["vector"].IsSequence())
             {
                 vector_ = node["vector"].as<osg::Vec3>();
-                read_vector_from_file_ = false;
+            }
+            else if (readColumn(node["vector"], vector_column_))
+            {
             }
             else
             {
-                file_stream_.open(path_to_config + node["vector"].as<std::string>());
-                read_vector_from_file_ = true;
+                vector_file_ = path_to_config + node["vector"].as<std::string>();
+                vector_source_ = new TextPoseSource(vector_file_);
             }
         }
 
 
-        void draw(  osg::ref_ptr<osg::Group> group,
-                    const std::ptrdiff_t iteration)
+        bool isAnimated() const
         {
-            if ((iteration >= first_iter_) && ((last_iter_ == -1) || (last_iter_ >= iteration)))
+            return (vector_source_.valid() || (vector_column_ >= 0) || SimpleShape::isAnimated());
+        }
+
+
+        void setShapeData(osg::ref_ptr<ShapeData> shape_data)
+        {
+            SimpleShape::setShapeData(shape_data);
+            checkColumns(vector_column_, 3);
+        }
+
+
+        /**
+         * @brief Reads the vector for the given iteration, the first line of
+         * the vector file corresponds to first_iter_.
+         */
+        void updateVisible(const std::ptrdiff_t iteration)
+        {
+            SimpleShape::updateVisible(iteration);
+
+            if (vector_column_ >= 0)
             {
-                if (read_vector_from_file_)
+                const osg::Vec3 vector = shape_data_->getVec3(vector_column_);
+
+                if (vector != vector_)
                 {
-                    std::string       line;
+                    vector_ = vector;
+                    setArrowVector(transform_, position_, vector_/vector_normalize_);
+                }
+                return;
+            }
+
+            if (!vector_source_.valid())
+            {
+                return;
+            }
 
-                    if (getline(file_stream_, line))
-                    {
-                        std::stringstream stream;
+            const std::ptrdiff_t frame = iteration - first_iter_;
 
-                        stream.str(line);
-                        stream.clear();
-                        readVector(stream, vector_);
-                    }
+            if (frame + 1 == next_frame_)
+            {
+                // the same iteration is displayed again
+                return;
+            }
+            moveToFrame(*vector_source_, next_frame_, frame, vector_buffer_);
+            next_frame_ = frame + 1;
+
+            if (vector_source_->readFrame(vector_buffer_))
+            {
+                osg::Vec3 vector(vector_buffer_[0], vector_buffer_[1], vector_buffer_[2]);
+
+                if (vector != vector_)
+                {
+                    vector_ = vector;
+                    setArrowVector(transform_, position_, vector_/vector_normalize_);
                 }
-                drawArrow(group, position_, vector_/vector_normalize_, color_);
+            }
+        }
+
+
+        void setPrefetchDepth(const std::size_t prefetch_depth)
+        {
+            if (vector_source_.valid())
+            {
+                vector_source_ = prefetchPoseSource(vector_file_, vector_source_, 3, prefetch_depth);
+            }
+        }
+
+
+        void printStatistics() const
+        {
+            if (vector_source_.valid())
+            {
+                vector_source_->printStatistics();
             }
         }
 };
 
 
-class Box : public SimpleShape
+/**
+ * @brief Many arrows drawn as a single geometry, all arrows are read from
+ * one file: each line contains base (x, y, z) and vector (x, y, z) of each
+ * arrow, the first line corresponds to first_iter_. Alternatively, the
+ * arrows are read from ShapeData starting from data_column.
+ */
+class ArrowField : public SimpleShape
 {
+    private:
+        std::string                 data_file_;
+        osg::ref_ptr<PoseSource>    arrow_source_;
+        std::vector<double>         arrow_buffer_;
+        osg::ref_ptr<osg::Geometry> geometry_;
+        /// index of the line of data_file_, which is read next
+        std::ptrdiff_t              next_frame_;
+        /// column of the first arrow in shape_data_, -1 if not used
+        std::ptrdiff_t              data_column_;
+
+
+    protected:
+        osg::ref_ptr<osg::PositionAttitudeTransform> create()
+        {
+            osg::ref_ptr<osg::PositionAttitudeTransform> field = createArrowField(color_, arrow_number_, geometry_);
+            field->setPosition(position_);
+            setArrowFieldVectors(geometry_, arrow_buffer_.data(), vector_normalize_);
+            return (field);
+        }
+
+
     public:
-        osg::Vec3 width_;
-        osg::Vec3 rpy_;
+        double      vector_normalize_;
+        std::size_t arrow_number_;
 
 
     public:
-        Box()
+        ArrowField()
         {
-            width_ = osg::Vec3(0., 0., 0.);
-            rpy_ = osg::Vec3(0., 0., 0.);
+            vector_normalize_ = 1.0;
+            arrow_number_ = 0;
+            next_frame_ = 0;
+            data_column_ = -1;
         }
 
         void read(const YAML::Node & node, const std::string & path_to_config)
         {
             SimpleShape::read(node, path_to_config);
 
-            rpy_ = node["rpy"].as<osg::Vec3>();
-            width_ = node["width"].as<osg::Vec3>();
+            vector_normalize_ = node["vector_normalize"].as<double>();
+            arrow_number_ = node["arrow_number"].as<std::size_t>();
+            if (0 == arrow_number_)
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // " + ("Arrow field must contain at least one arrow."));
+            }
+            arrow_buffer_.assign(arrow_number_ * 6, 0.0);
+
+            if (node["data_column"])
+            {
+                data_column_ = node["data_column"].as<std::ptrdiff_t>();
+            }
+            else
+            {
+                data_file_ = path_to_config + node["data_file"].as<std::string>();
+                arrow_source_ = new TextPoseSource(data_file_);
+            }
+        }
+
+
+        void setShapeData(osg::ref_ptr<ShapeData> shape_data)
+        {
+            SimpleShape::setShapeData(shape_data);
+            checkColumns(data_column_, arrow_number_ * 6);
+        }
+
+
+        bool isAnimated() const
+        {
+            return (true);
+        }
+
+
+        void updateVisible(const std::ptrdiff_t iteration)
+        {
+            SimpleShape::updateVisible(iteration);
+
+            const std::ptrdiff_t frame = iteration - first_iter_;
+
+            if (frame + 1 == next_frame_)
+            {
+                return;
+            }
+
+            if (data_column_ >= 0)
+            {
+                setArrowFieldVectors(geometry_, shape_data_->getColumns(data_column_), vector_normalize_);
+            }
+            else
+            {
+                moveToFrame(*arrow_source_, next_frame_, frame, arrow_buffer_);
+
+                if (arrow_source_->readFrame(arrow_buffer_))
+                {
+                    setArrowFieldVectors(geometry_, arrow_buffer_.data(), vector_normalize_);
+                }
+            }
+            next_frame_ = frame + 1;
         }
 
 
-        void draw(  osg::ref_ptr<osg::Group> group,
-                    const std::ptrdiff_t iteration)
+        void setPrefetchDepth(const std::size_t prefetch_depth)
         {
-            if ((iteration >= first_iter_) && ((last_iter_ == -1) || (last_iter_ >= iteration)))
+            if (arrow_source_.valid())
             {
-                drawBox(group, position_, rpy_, width_, color_);
+                arrow_source_ = prefetchPoseSource(data_file_, arrow_source_, arrow_buffer_.size(), prefetch_depth);
+            }
+        }
+
+
+        void printStatistics() const
+        {
+            if (arrow_source_.valid())
+            {
+                arrow_source_->printStatistics();
             }
         }
 };
 
 
-class Cube : public SimpleShape
+class Box : public SimpleShape
 {
+    protected:
+        osg::ref_ptr<osg::PositionAttitudeTransform> create()
+        {
+            return (createBox(position_, rpy_, width_, color_));
+        }
+
+
     public:
-        double width_;
-        osg::Vec3 rpy_;
+        osg::Vec3 width_;
 
 
     public:
-        Cube()
+        Box()
         {
-            width_ = 0.;
-            rpy_ = osg::Vec3(0., 0., 0.);
+            width_ = osg::Vec3(0., 0., 0.);
         }
 
         void read(const YAML::Node & node, const std::string & path_to_config)
         {
             SimpleShape::read(node, path_to_config);
 
-            rpy_ = node["rpy"].as<osg::Vec3>();
-            width_ = node["width"].as<double>();
+            if (!readColumn(node["rpy"], rpy_column_))
+            {
+                rpy_ = node["rpy"].as<osg::Vec3>();
+            }
+            width_ = node["width"].as<osg::Vec3>();
         }
+};
 
 
-        void draw(  osg::ref_ptr<osg::Group> group,
-                    const std::ptrdiff_t iteration)
+class Cube : public SimpleShape
+{
+    protected:
+        osg::ref_ptr<osg::PositionAttitudeTransform> create()
         {
-            if ((iteration >= first_iter_) && ((last_iter_ == -1) || (last_iter_ >= iteration)))
+            osg::Vec3 width = osg::Vec3(width_, width_, width_);
+            return (createBox(position_, rpy_, width, color_));
+        }
+
+
+    public:
+        double width_;
+
+
+    public:
+        Cube()
+        {
+            width_ = 0.;
+        }
+
+        void read(const YAML::Node & node, const std::string & path_to_config)
+        {
+            SimpleShape::read(node, path_to_config);
+
+            if (!readColumn(node["rpy"], rpy_column_))
             {
-                osg::Vec3 width = osg::Vec3(width_, width_, width_);
-                drawBox(group, position_, rpy_, width, color_);
+                rpy_ = node["rpy"].as<osg::Vec3>();
             }
+            width_ = node["width"].as<double>();
         }
 };
 
 
 class Sphere : public SimpleShape
 {
+    protected:
+        osg::ref_ptr<osg::PositionAttitudeTransform> create()
+        {
+            return (createSphere(position_, radius_, color_));
+        }
+
+
     public:
         double radius_;
 
@@ -260,25 +616,21 @@ class Sphere : public SimpleShape
 
             radius_ = node["radius"].as<double>();
         }
+};
 
 
-        void draw(  osg::ref_ptr<osg::Group> group,
-                    const std::ptrdiff_t iteration)
+class Cylinder : public SimpleShape
+{
+    protected:
+        osg::ref_ptr<osg::PositionAttitudeTransform> create()
         {
-            if ((iteration >= first_iter_) && ((last_iter_ == -1) || (last_iter_ >= iteration)))
-            {
-                drawSphere(group, position_, radius_, color_);
-            }
+            return (createCylinder(position_, rpy_, radius_, length_, color_));
         }
-};
 
 
-class Cylinder : public SimpleShape
-{
     public:
         double length_;
         double radius_;
-        osg::Vec3 rpy_;
 
 
     public:
@@ -286,30 +638,172 @@ class Cylinder : public SimpleShape
         {
             length_ = 0.0;
             radius_ = 0.0;
-            rpy_ = osg::Vec3(0., 0., 0.);
         }
 
         void read(const YAML::Node & node, const std::string & path_to_config)
         {
             SimpleShape::read(node, path_to_config);
 
-            rpy_ = node["rpy"].as<osg::Vec3>();
+            if (!readColumn(node["rpy"], rpy_column_))
+            {
+                rpy_ = node["rpy"].as<osg::Vec3>();
+            }
             length_ = node["length"].as<double>();
             radius_ = node["radius"].as<double>();
         }
+};
 
 
-        void draw(  osg::ref_ptr<osg::Group> group,
-                    const std::ptrdiff_t iteration)
+/**
+ * @brief Sorted list of events, which show or hide shapes at given
+ * iterations, so that only shapes, which change visibility, are touched.
+ */
+class ShapeTimeline
+{
+    protected:
+        struct Event
         {
-            if ((iteration >= first_iter_) && ((last_iter_ == -1) || (last_iter_ >= iteration)))
+            std::ptrdiff_t  iteration_;
+            std::size_t     shape_index_;
+            bool            show_;
+
+            Event(  const std::ptrdiff_t iteration,
+                    const std::size_t shape_index,
+                    const bool show)
+            {
+                iteration_ = iteration;
+                shape_index_ = shape_index;
+                show_ = show;
+            }
+
+            static bool compareIteration(const Event & event, const std::ptrdiff_t iteration)
             {
-                drawCylinder(group, position_, rpy_, radius_, length_, color_);
+                return (event.iteration_ < iteration);
+            }
+
+            static bool compare(const Event & event1, const Event & event2)
+            {
+                return (event1.iteration_ < event2.iteration_);
+            }
+        };
+
+
+    protected:
+        void applyEvent(const Event & event, const bool reverse)
+        {
+            const bool show = (event.show_ != reverse);
+            const std::size_t index = event.shape_index_;
+
+            shapes_[index]->setVisible(show);
+
+            if (shapes_[index]->isAnimated())
+            {
+                if (show)
+                {
+                    animated_position_[index] = animated_.size();
+                    animated_.push_back(index);
+                }
+                else
+                {
+                    std::size_t position = animated_position_[index];
+
+                    animated_[position] = animated_.back();
+                    animated_position_[animated_[position]] = position;
+                    animated_.pop_back();
+                }
+            }
+        }
+
+
+    public:
+        std::vector<osg::ref_ptr<SimpleShape> > shapes_;
+        osg::ref_ptr<ShapeData>                 shape_data_;
+        std::vector<Event>                      events_;
+
+        /// index of the first event, which is not applied yet
+        std::size_t                             next_event_;
+
+        /// visible animated shapes
+        std::vector<std::size_t>                animated_;
+        std::vector<std::size_t>                animated_position_;
+
+
+    public:
+        ShapeTimeline()
+        {
+            next_event_ = 0;
+        }
+
+
+        void build( const std::vector<osg::ref_ptr<SimpleShape> > & shapes,
+                    osg::ref_ptr<ShapeData> shape_data = NULL)
+        {
+            shapes_ = shapes;
+            shape_data_ = shape_data;
+            events_.clear();
+            animated_.clear();
+            animated_position_.assign(shapes_.size(), 0);
+            next_event_ = 0;
+
+            for (std::size_t i = 0; i < shapes_.size(); ++i)
+            {
+                if (shapes_[i]->last_iter_ == -1)
+                {
+                    events_.push_back(Event(shapes_[i]->first_iter_, i, true));
+                }
+                else if (shapes_[i]->last_iter_ >= shapes_[i]->first_iter_)
+                {
+                    events_.push_back(Event(shapes_[i]->first_iter_, i, true));
+                    events_.push_back(Event(shapes_[i]->last_iter_ + 1, i, false));
+                }
+            }
+
+            std::stable_sort(events_.begin(), events_.end(), Event::compare);
+        }
+
+
+        /**
+         * @brief Applies or reverts events, so that visibility of the shapes
+         * corresponds to the given iteration, the position in the timeline
+         * is found with binary search.
+         */
+        void seek(const std::ptrdiff_t iteration)
+        {
+            // events with iteration_ <= iteration must be applied
+            std::size_t target_event =
+                std::lower_bound(events_.begin(), events_.end(), iteration + 1, Event::compareIteration)
+                - events_.begin();
+
+            for (; next_event_ < target_event; ++next_event_)
+            {
+                applyEvent(events_[next_event_], false);
+            }
+
+            for (; next_event_ > target_event; --next_event_)
+            {
+                applyEvent(events_[next_event_ - 1], true);
+            }
+        }
+
+
+        void update(const std::ptrdiff_t iteration)
+        {
+            seek(iteration);
+
+            if (shape_data_.valid())
+            {
+                shape_data_->update(iteration);
+            }
+
+            for (std::size_t i = 0; i < animated_.size(); ++i)
+            {
+                shapes_[animated_[i]]->updateVisible(iteration);
             }
         }
 };
 
 
+
 class Configuration
 {
     private:
@@ -333,6 +827,8 @@ class Configuration
             std::string name_;
             std::string robot_description_file_;
             std::string data_file_;
+            /// the first column of the data file contains timestamps
+            bool timestamp_column_;
         };
 
 
@@ -360,9 +856,20 @@ class Configuration
 
     public:
         bool                                    enable_screenshots_;
+        std::size_t                             prefetch_depth_;
         std::string                             screenshot_filename_prefix_;
+        std::size_t                             screenshot_encoder_threads_;
+        std::size_t                             screenshot_queue_depth_;
+        std::string                             screenshot_output_;
+        std::size_t                             video_frame_rate_;
+        /// frames per second in the data files of robots, 0 if unknown
+        double                                  data_rate_;
+        /// displayed frames per second, 0 if the data is not resampled
+        double                                  display_rate_;
         std::vector<RobotDescription>           robots_;
         std::vector<osg::ref_ptr<SimpleShape> > shapes_;
+        osg::ref_ptr<ShapeData>                 shape_data_;
+        ShapeTimeline                           shape_timeline_;
         CameraPosition                          camera_;
         osg::Vec4                               background_color_;
 
@@ -392,12 +899,65 @@ class Configuration
             }
 
 
+            if (config["prefetch_depth"])
+            {
+                prefetch_depth_ = config["prefetch_depth"].as<std::size_t>();
+            }
+            else
+            {
+                prefetch_depth_ = 0;
+            }
+
+
             if (config["screenshot_filename_prefix"])
             {
                 screenshot_filename_prefix_ = path_to_config + config["screenshot_filename_prefix"].as<std::string>();
             }
 
 
+            screenshot_encoder_threads_ = std::max(std::thread::hardware_concurrency(), 1u);
+            if (config["screenshot_encoder_threads"])
+            {
+                screenshot_encoder_threads_ = config["screenshot_encoder_threads"].as<std::size_t>();
+            }
+
+            screenshot_queue_depth_ = 2 * screenshot_encoder_threads_;
+            if (config["screenshot_queue_depth"])
+            {
+                screenshot_queue_depth_ = config["screenshot_queue_depth"].as<std::size_t>();
+            }
+
+
+            screenshot_output_ = "images";
+            if (config["screenshot_output"])
+            {
+                screenshot_output_ = config["screenshot_output"].as<std::string>();
+                if ((screenshot_output_ != "images") && (screenshot_output_ != "y4m") && (screenshot_output_ != "ffmpeg"))
+                {
+                    throw std::runtime_error(std::string("In ") + __func__ + "() // " + ("Unknown screenshot output: " + screenshot_output_));
+                }
+            }
+
+            video_frame_rate_ = 200;
+            if (config["video_frame_rate"])
+            {
+                video_frame_rate_ = config["video_frame_rate"].as<std::size_t>();
+            }
+
+
+            data_rate_ = 0.0;
+            display_rate_ = 0.0;
+            if (config["data_rate"] && config["display_rate"])
+            {
+                data_rate_ = config["data_rate"].as<double>();
+                display_rate_ = config["display_rate"].as<double>();
+                if ((data_rate_ <= 0.0) || (display_rate_ <= 0.0))
+                {
+                    throw std::runtime_error(std::string("In ") + __func__ + "() // " + ("Data and display rates must be positive."));
+                }
+            }
+
+
             if (config["camera"])
             {
                 camera_.read(config["camera"]);
@@ -410,6 +970,14 @@ class Configuration
             }
 
 
+            if (config["shape_data"])
+            {
+                shape_data_ = new ShapeData(path_to_config + config["shape_data"]["data_file"].as<std::string>(),
+                                            config["shape_data"]["columns"].as<std::size_t>(),
+                                            prefetch_depth_);
+            }
+
+
             if (config["shapes"])
             {
                 YAML::Node shapes = config["shapes"];
@@ -420,8 +988,17 @@ class Configuration
                     readShapeIfTypeMatches<Box>(shapes[i], "box", path_to_config);
                     readShapeIfTypeMatches<Sphere>(shapes[i], "sphere", path_to_config);
                     readShapeIfTypeMatches<Arrow>(shapes[i], "arrow", path_to_config);
+                    readShapeIfTypeMatches<ArrowField>(shapes[i], "arrow_field", path_to_config);
                     readShapeIfTypeMatches<Cylinder>(shapes[i], "cylinder", path_to_config);
                 }
+
+                for (std::size_t i = 0; i < shapes_.size(); ++i)
+                {
+                    shapes_[i]->setShapeData(shape_data_);
+                    shapes_[i]->setPrefetchDepth(prefetch_depth_);
+                }
+
+                shape_timeline_.build(shapes_, shape_data_);
             }
 
 
@@ -436,11 +1013,40 @@ class Configuration
             {
                 RobotDescription robot;
 
-                robot.data_file_ = path_to_config + robots[i]["data_file"].as<std::string>();
+                robot.data_file_ = robots[i]["data_file"].as<std::string>();
+                if (("-" != robot.data_file_) && (0 != robot.data_file_.compare(0, 4, "shm:")))
+                {
+                    robot.data_file_ = path_to_config + robot.data_file_;
+                }
                 robot.name_ = robots[i]["name"].as<std::string>();
                 robot.robot_description_file_ = path_to_config + robots[i]["robot_description"].as<std::string>();
+                robot.timestamp_column_ = false;
+                if (robots[i]["timestamp_column"])
+                {
+                    robot.timestamp_column_ = robots[i]["timestamp_column"].as<bool>();
+                }
 
                 robots_.push_back(robot);
             }
         }
+
+
+        bool isResampled() const
+        {
+            return ((display_rate_ > 0.0) && (data_rate_ != display_rate_));
+        }
+
+
+        /**
+         * @brief Index of the data frame shown at the given iteration, used
+         * for data of shapes, which is not resampled.
+         */
+        std::ptrdiff_t getDataFrame(const std::ptrdiff_t iteration) const
+        {
+            if (isResampled())
+            {
+                return (static_cast<std::ptrdiff_t>(floor(iteration * data_rate_ / display_rate_ + 1e-6)));
+            }
+            return (iteration);
+        }
 };
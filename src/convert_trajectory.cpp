@@ -0,0 +1,175 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Converts text data files to the binary or compressed trajectory
+    format.
+*/
+
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+#include <osg/Quat>
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+
+#include "yaml-cpp/yaml.h"
+
+#include "pose_sources.h"
+
+void usage()
+{
+    printf("Options:\n");
+    printf("    -r 'robot description file' (required, provides names of the bodies)\n");
+    printf("    -i 'input text data file' (required)\n");
+    printf("    -o 'output binary data file' (required)\n");
+    printf("    -f (store poses as float instead of double)\n");
+    printf("    -z precision (write the compressed format with the given quantization step, e.g., 1e-5)\n");
+    printf("    -n number of frames in a chunk of the compressed format (default %d)\n", COMPRESSED_TRAJECTORY_CHUNK_SIZE);
+}
+
+
+int main(int argc, char **argv)
+{
+    int option;
+
+    char *robot_description_file = NULL;
+    char *input_file = NULL;
+    char *output_file = NULL;
+    bool use_float = false;
+    double precision = 0.0;
+    std::size_t chunk_size = COMPRESSED_TRAJECTORY_CHUNK_SIZE;
+
+    while ((option = getopt(argc, argv, "r:i:o:fz:n:")) != -1)
+    {
+        switch (option)
+        {
+            case 'r':
+                robot_description_file = optarg;
+                break;
+            case 'i':
+                input_file = optarg;
+                break;
+            case 'o':
+                output_file = optarg;
+                break;
+            case 'f':
+                use_float = true;
+                break;
+            case 'z':
+                precision = strtod(optarg, NULL);
+                break;
+            case 'n':
+                chunk_size = strtoul(optarg, NULL, 10);
+                if ((NULL != strchr(optarg, '-')) || (0 == chunk_size) || (chunk_size > UINT32_MAX))
+                {
+                    printf("Number of frames in a chunk must be in [1, %u].\n", UINT32_MAX);
+                    return(1);
+                }
+                break;
+            case '?':
+            default:
+                usage();
+                return(0);
+        }
+    }
+
+
+    if ((NULL == robot_description_file) || (NULL == input_file) || (NULL == output_file))
+    {
+        usage();
+        return(0);
+    }
+    try
+    {
+        YAML::Node config = YAML::LoadFile(robot_description_file);
+
+        if (!config["bodies"])
+        {
+            throw std::runtime_error(std::string("In ") + __func__ + "() // " + ("At least one body must be specified"));
+        }
+
+        std::vector<std::string> body_names;
+        YAML::Node bodies = config["bodies"];
+        for (std::size_t i = 0; i < bodies.size(); ++i)
+        {
+            body_names.push_back(bodies[i]["name"].as<std::string>());
+        }
+
+
+        TextPoseSource          input(input_file);
+        std::vector<double>     poses(body_names.size() * 6);
+
+        if (input.file_stream_.fail())
+        {
+            throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot open input file: " + input_file);
+        }
+
+        if (precision > 0.0)
+        {
+            CompressedTrajectoryWriter output(output_file, body_names, precision, chunk_size);
+
+            while (input.readFrame(poses))
+            {
+                output.writeFrame(poses);
+            }
+            output.close();
+
+            std::ifstream input_size_check(input_file, std::ios::binary | std::ios::ate);
+            const double input_size = input_size_check.tellg();
+            const double raw_size = output.header_.frame_number_ * output.header_.getFrameSize() * sizeof(double);
+
+            std::cout << "Converted " << output.header_.frame_number_ << " frames of "
+                      << output.header_.body_number_ << " bodies to `" << output_file << "`: "
+                      << output.chunks_.size() << " chunks, " << output.getSize() << " bytes" << std::endl;
+            std::cout << "Compression ratio: " << input_size / output.getSize() << " (text), "
+                      << raw_size / output.getSize() << " (double)" << std::endl;
+
+
+            // single threaded decoding of the whole file
+            CompressedTrajectoryFile    trajectory(output_file);
+            std::vector<double>         frames;
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < trajectory.header_->getChunkNumber(); ++i)
+            {
+                trajectory.decodeChunk(i, frames);
+            }
+            const double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (duration > 0.0)
+            {
+                std::cout << "Decoding throughput: " << trajectory.header_->frame_number_ / duration << " frames/s, "
+                          << raw_size / duration / (1024 * 1024) << " MB/s of poses (one thread)" << std::endl;
+            }
+        }
+        else
+        {
+            BinaryTrajectoryWriter  output(output_file, body_names, use_float);
+
+            while (input.readFrame(poses))
+            {
+                output.writeFrame(poses);
+            }
+            output.close();
+
+            std::cout << "Converted " << output.header_.frame_number_ << " frames of "
+                      << output.header_.body_number_ << " bodies to `" << output_file << "`" << std::endl;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << std::endl;
+        return (1);
+    }
+
+    return 0;
+}
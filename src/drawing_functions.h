@@ -93,21 +93,69 @@ void drawFrame( osg::ref_ptr<osg::Group> group,
 
 
 
-void drawArrow( osg::ref_ptr<osg::Group> group,
-                const osg::Vec3 &base,
-                const osg::Vec3 &direction,
-                const osg::Vec4 &color)
+/**
+ * @brief Creates an arrow pointing along Z axis, the length is set with
+ * setArrowVector().
+ *
+ * The arrow consists of a unit cylinder (body) and a cone (head), which
+ * are sized by their own transforms, so that changes of the vector never
+ * require rebuilding the geometry.
+ */
+osg::ref_ptr<osg::PositionAttitudeTransform> createArrow(const osg::Vec4 &color)
 {
-    double head_radius = 0.015;
-    double head_length = 0.06;
-    osg::Vec3 head_position;
+    const double head_radius = 0.015;
+    const double head_length = 0.06;
+    const double body_radius = 0.005;
+
+
+    osg::ref_ptr<osg::ShapeDrawable> cone_drawable = new osg::ShapeDrawable(
+            new osg::Cone(osg::Vec3(0., 0., 0.), head_radius, head_length));
+    cone_drawable->setColor( color );
+
+    osg::ref_ptr<osg::Geode> cone_geode = new osg::Geode();
+    cone_geode->addDrawable(cone_drawable);
+
+    osg::ref_ptr<osg::PositionAttitudeTransform> head_transform = new osg::PositionAttitudeTransform;
+    head_transform->setDataVariance(osg::Object::DYNAMIC);
+    head_transform->addChild(cone_geode);
+
+
+    osg::ref_ptr<osg::ShapeDrawable> cylinder_drawable = new osg::ShapeDrawable(
+            new osg::Cylinder(osg::Vec3(0., 0., 0.5), body_radius, 1.0));
+    cylinder_drawable->setColor( color );
+
+    osg::ref_ptr<osg::Geode> cylinder_geode = new osg::Geode();
+    cylinder_geode->addDrawable(cylinder_drawable);
+
+    osg::ref_ptr<osg::PositionAttitudeTransform> body_transform = new osg::PositionAttitudeTransform;
+    body_transform->setDataVariance(osg::Object::DYNAMIC);
+    body_transform->addChild(cylinder_geode);
 
-    double body_radius = 0.005;
+
+    osg::ref_ptr<osg::PositionAttitudeTransform> composite_transform = new osg::PositionAttitudeTransform;
+    composite_transform->setDataVariance(osg::Object::DYNAMIC);
+    composite_transform->addChild(body_transform);
+    composite_transform->addChild(head_transform);
+
+    return (composite_transform);
+}
+
+
+
+/**
+ * @brief Places an arrow created with createArrow().
+ */
+void setArrowVector(osg::ref_ptr<osg::PositionAttitudeTransform> arrow,
+                    const osg::Vec3 &base,
+                    const osg::Vec3 &direction)
+{
+    double head_length = 0.06;
     double body_length = 0.0;
-    osg::Vec3 body_position;
+    double head_scale = 1.0;
 
     if (head_length > direction.length())
     {
+        head_scale = direction.length() / head_length;
         head_length = direction.length();
         body_length = 0.0;
     }
@@ -115,28 +163,36 @@ void drawArrow( osg::ref_ptr<osg::Group> group,
     {
         body_length = direction.length() - head_length;
     }
-    body_position = osg::Vec3(0., 0., (direction.length() - head_length)/2);
-    head_position = osg::Vec3(0., 0., direction.length() - head_length);
-
 
-    osg::ref_ptr<osg::Cone> cone_shape = new osg::Cone( head_position, head_radius, head_length);
-    cone_shape->setDataVariance(osg::Object::DYNAMIC);
 
-    osg::ref_ptr<osg::Cylinder> cylinder_shape = new osg::Cylinder( body_position, body_radius, body_length);
-    cylinder_shape->setDataVariance(osg::Object::DYNAMIC);
+    osg::PositionAttitudeTransform * body_transform =
+        static_cast<osg::PositionAttitudeTransform *>(arrow->getChild(0));
+    osg::PositionAttitudeTransform * head_transform =
+        static_cast<osg::PositionAttitudeTransform *>(arrow->getChild(1));
 
-    osg::ref_ptr<osg::CompositeShape> composite_shape = new osg::CompositeShape();
-    composite_shape->addChild(cone_shape);
-    composite_shape->addChild(cylinder_shape);
+    if (body_length > 0.0)
+    {
+        body_transform->setScale(osg::Vec3(1., 1., body_length));
+        body_transform->setNodeMask(~0u);
+    }
+    else
+    {
+        body_transform->setNodeMask(0);
+    }
 
-    osg::ref_ptr<osg::ShapeDrawable> composite_drawable = new osg::ShapeDrawable(composite_shape);
-    composite_drawable->setColor( color );
+    if (head_length > 0.0)
+    {
+        head_transform->setPosition(osg::Vec3(0., 0., direction.length() - head_length));
+        head_transform->setScale(osg::Vec3(1., 1., head_scale));
+        head_transform->setNodeMask(~0u);
+    }
+    else
+    {
+        head_transform->setNodeMask(0);
+    }
 
-    osg::ref_ptr<osg::Geode> composite_geode = new osg::Geode();
-    composite_geode->addDrawable(composite_drawable);
 
-    osg::ref_ptr<osg::PositionAttitudeTransform> composite_transform = new osg::PositionAttitudeTransform;
-    composite_transform->setPosition(base);
+    arrow->setPosition(base);
 
     osg::Vec3 normalized_direction = direction;
     normalized_direction.normalize();
@@ -145,23 +201,31 @@ void drawArrow( osg::ref_ptr<osg::Group> group,
     {
         rotation_axis = osg::Vec3(0., 0., 1.) ^ osg::Vec3(0., 1., 0.);
     }
-    composite_transform->setAttitude(osg::Quat( acos(osg::Vec3(0., 0., 1.) * normalized_direction),
-                                                rotation_axis));
-    composite_transform->addChild(composite_geode);
-
-    group->addChild(composite_transform);
+    arrow->setAttitude(osg::Quat( acos(osg::Vec3(0., 0., 1.) * normalized_direction),
+                                  rotation_axis));
 }
 
 
 
-void drawBox(   osg::ref_ptr<osg::Group> group,
-                const osg::Vec3 &position,
-                const osg::Vec3 &rpy,
-                const osg::Vec3 &width,
+void drawArrow( osg::ref_ptr<osg::Group> group,
+                const osg::Vec3 &base,
+                const osg::Vec3 &direction,
                 const osg::Vec4 &color)
+{
+    osg::ref_ptr<osg::PositionAttitudeTransform> arrow = createArrow(color);
+    setArrowVector(arrow, base, direction);
+
+    group->addChild(arrow);
+}
+
+
+
+osg::ref_ptr<osg::PositionAttitudeTransform> createBox( const osg::Vec3 &position,
+                                                        const osg::Vec3 &rpy,
+                                                        const osg::Vec3 &width,
+                                                        const osg::Vec4 &color)
 {
     osg::ref_ptr<osg::Box> box_shape = new osg::Box( osg::Vec3(0,0,0), width.x(), width.y(), width.z());
-    box_shape->setDataVariance(osg::Object::DYNAMIC);
 
     osg::ref_ptr<osg::ShapeDrawable> box_drawable = new osg::ShapeDrawable(box_shape);
     box_drawable->setColor( color );
@@ -175,18 +239,26 @@ void drawBox(   osg::ref_ptr<osg::Group> group,
     box_transform->setAttitude(convertRPYtoQuaternion(rpy));
     box_transform->addChild(box_geode);
 
-    group->addChild(box_transform);
+    return (box_transform);
 }
 
 
-
-void drawSphere(osg::ref_ptr<osg::Group> group,
+void drawBox(   osg::ref_ptr<osg::Group> group,
                 const osg::Vec3 &position,
-                const double radius,
+                const osg::Vec3 &rpy,
+                const osg::Vec3 &width,
                 const osg::Vec4 &color)
+{
+    group->addChild(createBox(position, rpy, width, color));
+}
+
+
+
+osg::ref_ptr<osg::PositionAttitudeTransform> createSphere(  const osg::Vec3 &position,
+                                                            const double radius,
+                                                            const osg::Vec4 &color)
 {
     osg::ref_ptr<osg::Sphere> sphere_shape = new osg::Sphere( osg::Vec3(0,0,0), radius);
-    sphere_shape->setDataVariance(osg::Object::DYNAMIC);
 
     osg::ref_ptr<osg::ShapeDrawable> sphere_drawable = new osg::ShapeDrawable(sphere_shape);
     sphere_drawable->setColor( color );
@@ -199,20 +271,27 @@ void drawSphere(osg::ref_ptr<osg::Group> group,
     sphere_transform->setPosition(position);
     sphere_transform->addChild(sphere_geode);
 
-    group->addChild(sphere_transform);
+    return (sphere_transform);
 }
 
 
-
-void drawCylinder(osg::ref_ptr<osg::Group> group,
+void drawSphere(osg::ref_ptr<osg::Group> group,
                 const osg::Vec3 &position,
-                const osg::Vec3 &rpy,
                 const double radius,
-                const double length,
                 const osg::Vec4 &color)
+{
+    group->addChild(createSphere(position, radius, color));
+}
+
+
+
+osg::ref_ptr<osg::PositionAttitudeTransform> createCylinder(const osg::Vec3 &position,
+                                                            const osg::Vec3 &rpy,
+                                                            const double radius,
+                                                            const double length,
+                                                            const osg::Vec4 &color)
 {
     osg::ref_ptr<osg::Cylinder> cylinder_shape = new osg::Cylinder( osg::Vec3(0,0,0), radius, length);
-    cylinder_shape->setDataVariance(osg::Object::DYNAMIC);
 
 
     osg::ref_ptr<osg::ShapeDrawable> cylinder_drawable = new osg::ShapeDrawable(cylinder_shape);
@@ -227,5 +306,185 @@ void drawCylinder(osg::ref_ptr<osg::Group> group,
     cylinder_transform->setAttitude(convertRPYtoQuaternion(rpy));
     cylinder_transform->addChild(cylinder_geode);
 
-    group->addChild(cylinder_transform);
+    return (cylinder_transform);
+}
+
+
+void drawCylinder(osg::ref_ptr<osg::Group> group,
+                const osg::Vec3 &position,
+                const osg::Vec3 &rpy,
+                const double radius,
+                const double length,
+                const osg::Vec4 &color)
+{
+    group->addChild(createCylinder(position, rpy, radius, length, color));
+}
+
+
+
+#define ARROW_FIELD_HEAD_SEGMENTS 6
+// base and end of the body, apex and ring of the head
+#define ARROW_FIELD_ARROW_VERTICES (3 + ARROW_FIELD_HEAD_SEGMENTS)
+
+
+/**
+ * @brief Creates a single geometry for arrow_number arrows, which are placed
+ * with setArrowFieldVectors().
+ *
+ * Bodies are lines and heads are cones made of triangles, connectivity of
+ * the vertices never changes, only the vertex array is updated. The field is
+ * not lit, so that normals do not need to be updated.
+ *
+ * @param[in] color
+ * @param[in] arrow_number
+ * @param[out] geometry     must be passed to setArrowFieldVectors()
+ */
+osg::ref_ptr<osg::PositionAttitudeTransform> createArrowField(
+        const osg::Vec4 &color,
+        const std::size_t arrow_number,
+        osg::ref_ptr<osg::Geometry> &geometry)
+{
+    osg::ref_ptr<osg::Geode>        geode = new osg::Geode;
+    osg::ref_ptr<osg::Vec3Array>    points = new osg::Vec3Array(arrow_number * ARROW_FIELD_ARROW_VERTICES);
+    osg::ref_ptr<osg::Vec4Array>    colors = new osg::Vec4Array;
+
+    osg::ref_ptr<osg::DrawElementsUInt> bodies = new osg::DrawElementsUInt(osg::PrimitiveSet::LINES);
+    osg::ref_ptr<osg::DrawElementsUInt> heads = new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES);
+
+    for (std::size_t i = 0; i < arrow_number; ++i)
+    {
+        const unsigned int first = i * ARROW_FIELD_ARROW_VERTICES;
+
+        bodies->push_back(first);
+        bodies->push_back(first + 1);
+
+        for (unsigned int j = 0; j < ARROW_FIELD_HEAD_SEGMENTS; ++j)
+        {
+            heads->push_back(first + 2);
+            heads->push_back(first + 3 + j);
+            heads->push_back(first + 3 + (j + 1) % ARROW_FIELD_HEAD_SEGMENTS);
+        }
+    }
+    colors->push_back(color);
+
+
+    geometry = new osg::Geometry;
+    geometry->setDataVariance(osg::Object::DYNAMIC);
+    geometry->setUseDisplayList(false);
+    geometry->setUseVertexBufferObjects(true);
+    geometry->setVertexArray(points.get());
+    geometry->setColorArray(colors.get());
+    geometry->setColorBinding(osg::Geometry::BIND_OVERALL);
+    geometry->addPrimitiveSet(bodies.get());
+    geometry->addPrimitiveSet(heads.get());
+
+    osg::ref_ptr<osg::LineWidth>  linewidth = new osg::LineWidth();
+    linewidth->setWidth(2.0f);
+
+    geode->addDrawable(geometry.get());
+    geode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+    geode->getOrCreateStateSet()->setAttributeAndModes(linewidth, osg::StateAttribute::ON);
+
+    osg::ref_ptr<osg::PositionAttitudeTransform> field_transform = new osg::PositionAttitudeTransform;
+    field_transform->addChild(geode);
+
+    return (field_transform);
+}
+
+
+
+/**
+ * @brief Places arrows of a field created with createArrowField().
+ *
+ * @param[in,out] geometry
+ * @param[in] arrows    6 values per arrow: base and vector
+ * @param[in] vector_normalize  vectors are divided by this value
+ */
+void setArrowFieldVectors(  osg::ref_ptr<osg::Geometry> geometry,
+                            const double * arrows,
+                            const double vector_normalize)
+{
+    const double head_radius = 0.015;
+
+    osg::Vec3Array & points = *static_cast<osg::Vec3Array *>(geometry->getVertexArray());
+    const std::size_t arrow_number = points.size() / ARROW_FIELD_ARROW_VERTICES;
+
+    for (std::size_t i = 0; i < arrow_number; ++i, arrows += 6)
+    {
+        const osg::Vec3 base(arrows[0], arrows[1], arrows[2]);
+        osg::Vec3 direction(arrows[3], arrows[4], arrows[5]);
+        direction = direction / vector_normalize;
+
+        osg::Vec3 * vertices = &points[i * ARROW_FIELD_ARROW_VERTICES];
+
+        // same proportions as createArrow()
+        const double length = direction.length();
+        const double head_length = std::min(0.06, length);
+        const double radius = head_radius * (head_length / 0.06);
+
+        if (length > 0.0)
+        {
+            direction = direction / length;
+        }
+
+        // any two vectors orthogonal to the direction
+        osg::Vec3 axis1 = direction ^ (fabs(direction.x()) < 0.9 ? osg::Vec3(1., 0., 0.) : osg::Vec3(0., 1., 0.));
+        axis1.normalize();
+        const osg::Vec3 axis2 = direction ^ axis1;
+
+        const osg::Vec3 head_base = base + direction * (length - head_length);
+
+        vertices[0] = base;
+        vertices[1] = head_base;
+        vertices[2] = base + direction * length;
+        for (std::size_t j = 0; j < ARROW_FIELD_HEAD_SEGMENTS; ++j)
+        {
+            const double angle = 2.0 * M_PI * j / ARROW_FIELD_HEAD_SEGMENTS;
+            vertices[3 + j] = head_base + (axis1 * cos(angle) + axis2 * sin(angle)) * radius;
+        }
+    }
+
+    points.dirty();
+    geometry->dirtyBound();
+}
+
+
+
+/**
+ * @brief Changes color of a shape created with one of the functions above.
+ */
+void setShapeColor( osg::Node * node,
+                    const osg::Vec4 &color)
+{
+    osg::Geode * geode = dynamic_cast<osg::Geode *>(node);
+
+    if (NULL != geode)
+    {
+        for (unsigned int i = 0; i < geode->getNumDrawables(); ++i)
+        {
+            osg::ShapeDrawable * shape_drawable = dynamic_cast<osg::ShapeDrawable *>(geode->getDrawable(i));
+            osg::Geometry * geometry = dynamic_cast<osg::Geometry *>(geode->getDrawable(i));
+
+            if (NULL != shape_drawable)
+            {
+                shape_drawable->setColor(color);
+            }
+            else if (NULL != geometry)
+            {
+                osg::Vec4Array * colors = dynamic_cast<osg::Vec4Array *>(geometry->getColorArray());
+                if ((NULL != colors) && (colors->size() > 0))
+                {
+                    (*colors)[0] = color;
+                    colors->dirty();
+                }
+            }
+        }
+    }
+    else if (NULL != node->asGroup())
+    {
+        for (unsigned int i = 0; i < node->asGroup()->getNumChildren(); ++i)
+        {
+            setShapeColor(node->asGroup()->getChild(i), color);
+        }
+    }
 }
@@ -0,0 +1,209 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Index of byte offsets of non-blank lines (frames) in text data files.
+
+    The index is stored next to the data file in '<data file>.idx' and is
+    rebuilt when size or modification time of the data file changes. Layout
+    of the index file (native byte order):
+        1. FrameIndexHeader;
+        2. FrameIndexHeader::frame_number_ offsets (uint64_t) of the first
+           characters of the non-blank lines;
+        3. FrameIndexHeader::frame_number_ indices (uint64_t) of these lines
+           in the file starting from 0, used in error messages.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "text_scanner.h"
+
+
+#define FRAME_INDEX_MAGIC "ORVFIX3"
+
+
+struct FrameIndexHeader
+{
+    char        magic_[8];
+    uint64_t    data_file_size_;
+    int64_t     data_file_mtime_sec_;
+    int64_t     data_file_mtime_nsec_;
+    uint64_t    frame_number_;
+
+
+    FrameIndexHeader()
+    {
+        memset(this, 0, sizeof(FrameIndexHeader));
+        memcpy(magic_, FRAME_INDEX_MAGIC, sizeof(FRAME_INDEX_MAGIC));
+    }
+
+
+    /**
+     * @brief Sets identification of the data file.
+     */
+    void setDataFile(const struct stat & file_stat)
+    {
+        data_file_size_ = file_stat.st_size;
+        data_file_mtime_sec_ = file_stat.st_mtim.tv_sec;
+        data_file_mtime_nsec_ = file_stat.st_mtim.tv_nsec;
+    }
+
+
+    bool matches(const FrameIndexHeader & other) const
+    {
+        return ( (0 == memcmp(magic_, other.magic_, sizeof(magic_)))
+                && (data_file_size_ == other.data_file_size_)
+                && (data_file_mtime_sec_ == other.data_file_mtime_sec_)
+                && (data_file_mtime_nsec_ == other.data_file_mtime_nsec_));
+    }
+};
+
+
+
+class FrameIndex
+{
+    protected:
+        /**
+         * @brief Scans the data file for non-blank lines.
+         */
+        void build(const std::string & data_file)
+        {
+            FILE * file = fopen(data_file.c_str(), "rb");
+            if (NULL == file)
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot open file: " + data_file);
+            }
+
+            std::vector<char>   buffer(1 << 20);
+            uint64_t            offset = 0;
+            uint64_t            line_offset = 0;
+            uint64_t            line_index = 0;
+            bool                line_blank = true;
+
+            offsets_.clear();
+            line_indices_.clear();
+            for (;;)
+            {
+                std::size_t size = fread(&buffer[0], 1, buffer.size(), file);
+                if (0 == size)
+                {
+                    break;
+                }
+
+                for (std::size_t i = 0; i < size; ++i, ++offset)
+                {
+                    if ('\n' == buffer[i])
+                    {
+                        line_offset = offset + 1;
+                        ++line_index;
+                        line_blank = true;
+                    }
+                    else if (line_blank && !TextScanner::isSpace(buffer[i]))
+                    {
+                        // blank lines are skipped by TextPoseSource
+                        offsets_.push_back(line_offset);
+                        line_indices_.push_back(line_index);
+                        line_blank = false;
+                    }
+                }
+            }
+            fclose(file);
+
+            header_.frame_number_ = offsets_.size();
+        }
+
+
+        bool load(const std::string & index_file)
+        {
+            FILE * file = fopen(index_file.c_str(), "rb");
+            if (NULL == file)
+            {
+                return (false);
+            }
+
+            FrameIndexHeader header;
+            bool loaded = false;
+
+            if ((1 == fread(&header, sizeof(FrameIndexHeader), 1, file))
+                    && (header.matches(header_))
+                    && (header.frame_number_ <= header.data_file_size_))
+            {
+                offsets_.resize(header.frame_number_);
+                line_indices_.resize(header.frame_number_);
+                loaded = (offsets_.size() == fread(offsets_.data(), sizeof(uint64_t), offsets_.size(), file))
+                        && (line_indices_.size() == fread(line_indices_.data(), sizeof(uint64_t), line_indices_.size(), file));
+                header_.frame_number_ = header.frame_number_;
+            }
+            fclose(file);
+
+            return (loaded);
+        }
+
+
+        void save(const std::string & index_file) const
+        {
+            FILE * file = fopen(index_file.c_str(), "wb");
+            if (NULL == file)
+            {
+                // the index is an optimization, e.g., the directory may be read-only
+                return;
+            }
+
+            bool saved = (1 == fwrite(&header_, sizeof(FrameIndexHeader), 1, file))
+                        && (offsets_.size() == fwrite(offsets_.data(), sizeof(uint64_t), offsets_.size(), file))
+                        && (line_indices_.size() == fwrite(line_indices_.data(), sizeof(uint64_t), line_indices_.size(), file));
+            fclose(file);
+
+            if (!saved)
+            {
+                remove(index_file.c_str());
+            }
+        }
+
+
+    public:
+        FrameIndexHeader        header_;
+        std::vector<uint64_t>   offsets_;
+        std::vector<uint64_t>   line_indices_;
+
+
+    public:
+        /**
+         * @brief Loads the index of a data file or builds it if the stored
+         * index is missing or outdated.
+         */
+        FrameIndex(const std::string & data_file)
+        {
+            struct stat file_stat;
+            if (stat(data_file.c_str(), &file_stat) < 0)
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot stat file: " + data_file);
+            }
+            header_.setDataFile(file_stat);
+
+
+            const std::string index_file = data_file + ".idx";
+            if (!load(index_file))
+            {
+                build(data_file);
+                save(index_file);
+            }
+        }
+
+
+        std::size_t getFrameNumber() const
+        {
+            return (offsets_.size());
+        }
+};
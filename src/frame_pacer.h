@@ -0,0 +1,226 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Playback pacing with absolute deadlines.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <algorithm>
+
+
+/// at least this number of frames is displayed per second while skipping
+#define FRAME_PACER_MIN_DISPLAY_RATE 10.0
+/// rate of displaying frames, which do not advance the data, e.g., in a pause
+#define FRAME_PACER_IDLE_RATE 60.0
+
+
+/**
+ * @brief Schedules frames at absolute deadlines derived from the data time,
+ * so that render and parse time do not accumulate into a drift.
+ *
+ * Data time of a frame is either its timestamp or frame_index * period.
+ * The deadline of a frame is start + (data_time - first_data_time) /
+ * real_time_factor. Frames, which are ready after their deadline, are not
+ * delayed, the delay is reported as lag.
+ *
+ * Optionally, late frames are skipped to hold real time: a frame is not
+ * displayed if it would be shown after the deadline of the next frame given
+ * the average cost of displaying a frame, see isLate().
+ */
+class FramePacer
+{
+    protected:
+        typedef std::chrono::steady_clock   Clock;
+
+
+    protected:
+        double              real_time_factor_;
+
+        bool                started_;
+        Clock::time_point   start_time_;
+        double              first_data_time_;
+
+        /// wall-clock start of playback, not affected by restart()
+        bool                playback_started_;
+        Clock::time_point   playback_start_time_;
+
+        std::size_t         frame_counter_;
+        double              lag_;
+        double              max_lag_;
+        double              total_lag_;
+
+        /// deadline of the current frame and its distance to the previous one [s]
+        Clock::time_point   deadline_;
+        double              period_;
+
+        /// average cost of displaying a frame [s], see finishFrame()
+        double              frame_cost_;
+        Clock::time_point   wake_time_;
+        Clock::time_point   display_time_;
+        std::size_t         skip_counter_;
+
+
+    public:
+        /**
+         * @param[in] real_time_factor  playback speed relative to the data
+         *                              time, e.g., 0.5 is two times slower
+         */
+        FramePacer(const double real_time_factor = 1.0)
+        {
+            real_time_factor_ = real_time_factor;
+
+            started_ = false;
+            first_data_time_ = 0.0;
+            playback_started_ = false;
+
+            frame_counter_ = 0;
+            lag_ = 0.0;
+            max_lag_ = 0.0;
+            total_lag_ = 0.0;
+
+            period_ = 0.0;
+            frame_cost_ = 0.0;
+            skip_counter_ = 0;
+        }
+
+
+        /**
+         * @brief Sleeps until the deadline of a frame.
+         *
+         * @param[in] data_time time of the frame in the data [s]
+         */
+        void waitForFrame(const double data_time)
+        {
+            const Clock::time_point now = Clock::now();
+
+            if (!playback_started_)
+            {
+                playback_started_ = true;
+                playback_start_time_ = now;
+            }
+
+            if (!started_)
+            {
+                started_ = true;
+                start_time_ = now;
+                first_data_time_ = data_time;
+                deadline_ = now;
+                display_time_ = now;
+            }
+
+            const Clock::time_point deadline = start_time_
+                + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>((data_time - first_data_time_) / real_time_factor_));
+            period_ = std::chrono::duration<double>(deadline - deadline_).count();
+            deadline_ = deadline;
+
+            if (now < deadline)
+            {
+                std::this_thread::sleep_until(deadline);
+                lag_ = 0.0;
+            }
+            else
+            {
+                lag_ = std::chrono::duration<double>(now - deadline).count();
+                max_lag_ = std::max(max_lag_, lag_);
+                total_lag_ += lag_;
+            }
+            wake_time_ = Clock::now();
+
+            ++frame_counter_;
+        }
+
+
+        /**
+         * @brief Sleeps before displaying a frame, which does not advance the
+         * data, e.g., during a pause. Such frames are not counted, the next
+         * frame restarts the deadlines.
+         */
+        void waitIdle()
+        {
+            restart();
+            std::this_thread::sleep_for(std::chrono::duration<double>(1.0 / FRAME_PACER_IDLE_RATE));
+        }
+
+
+        /**
+         * @brief True if the current frame is late: displaying it would take
+         * longer than the time left until the deadline of the next frame.
+         * Frames are not reported late if nothing was displayed for
+         * 1/FRAME_PACER_MIN_DISPLAY_RATE seconds.
+         */
+        bool isLate() const
+        {
+            return ((lag_ > 0.0)
+                    && (lag_ + frame_cost_ > period_)
+                    && (std::chrono::duration<double>(wake_time_ - display_time_).count() < 1.0 / FRAME_PACER_MIN_DISPLAY_RATE));
+        }
+
+
+        /**
+         * @brief Counts a frame, which was not displayed.
+         */
+        void skipFrame()
+        {
+            ++skip_counter_;
+        }
+
+
+        /**
+         * @brief Updates the cost of displaying a frame, must be called after
+         * a frame is displayed.
+         */
+        void finishFrame()
+        {
+            display_time_ = Clock::now();
+
+            const double frame_cost = std::chrono::duration<double>(display_time_ - wake_time_).count();
+            // exponential moving average, adapts to the load in a few frames
+            frame_cost_ = (0.0 == frame_cost_) ? frame_cost : 0.8 * frame_cost_ + 0.2 * frame_cost;
+        }
+
+
+        /**
+         * @brief The next frame becomes the reference for the following
+         * deadlines, e.g., after a pause or a jump.
+         */
+        void restart()
+        {
+            started_ = false;
+        }
+
+
+        /**
+         * @brief Delay of the last frame with respect to its deadline [s].
+         */
+        double getLag() const
+        {
+            return (lag_);
+        }
+
+
+        void printStatistics() const
+        {
+            if (frame_counter_ > 1)
+            {
+                const double elapsed = std::chrono::duration<double>(Clock::now() - playback_start_time_).count();
+
+                std::cout << "Playback: " << frame_counter_ << " frames in " << elapsed << " s ("
+                          << frame_counter_ / elapsed << " fps), lag: last " << lag_ * 1000.0
+                          << " ms, max " << max_lag_ * 1000.0
+                          << " ms, average " << total_lag_ / frame_counter_ * 1000.0 << " ms" << std::endl;
+                if (skip_counter_ > 0)
+                {
+                    std::cout << "Playback: " << skip_counter_ << " of " << frame_counter_
+                              << " frames skipped, average display cost " << frame_cost_ * 1000.0 << " ms" << std::endl;
+                }
+            }
+        }
+};
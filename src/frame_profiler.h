@@ -0,0 +1,460 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Timing of the phases of frames and counters of work done.
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+
+/**
+ * @brief Collects durations of the phases of each frame and counters, e.g.,
+ * of parsed bytes, for export as Chrome trace events ('chrome://tracing',
+ * Perfetto), as a CSV table with a row per frame, and as a percentile
+ * summary.
+ *
+ * The profiler is global, so that phases can be timed where they happen
+ * (callbacks, pose sources, image writers). It is disabled by default, then
+ * timers and counters only check a flag. Phases may be timed in any thread,
+ * they are attributed to the frame, which is open at the end of the phase.
+ */
+class FrameProfiler
+{
+    public:
+        typedef std::chrono::steady_clock   Clock;
+
+        enum Phase
+        {
+            /// update of simple shapes
+            SHAPES = 0,
+            /// Robot::readStates()
+            READ = 1,
+            /// waiting for the deadline of the frame
+            WAIT = 2,
+            /// update traversal of robots
+            UPDATE = 3,
+            CULL = 4,
+            DRAW = 5,
+            /// SnapImageDrawCallback
+            SNAPSHOT = 6,
+            PHASE_NUMBER = 7
+        };
+
+        enum Counter
+        {
+            BYTES_PARSED = 0,
+            NODES_ALLOCATED = 1,
+            IMAGES_WRITTEN = 2,
+            COUNTER_NUMBER = 3
+        };
+
+
+        /**
+         * @brief Times the enclosing scope.
+         */
+        class ScopedTimer
+        {
+            protected:
+                Phase               phase_;
+                bool                enabled_;
+                Clock::time_point   begin_;
+
+
+            public:
+                ScopedTimer(const Phase phase)
+                {
+                    phase_ = phase;
+                    enabled_ = FrameProfiler::isEnabled();
+                    if (enabled_)
+                    {
+                        begin_ = Clock::now();
+                    }
+                }
+
+
+                ~ScopedTimer()
+                {
+                    if (enabled_)
+                    {
+                        FrameProfiler::getInstance().addPhase(phase_, begin_, Clock::now());
+                    }
+                }
+        };
+
+
+    protected:
+        struct Event
+        {
+            Phase           phase_;
+            std::size_t     thread_;
+            /// [us] since the start of profiling
+            double          begin_;
+            double          duration_;
+        };
+
+
+        struct Frame
+        {
+            std::ptrdiff_t  iteration_;
+            /// [us] since the start of profiling
+            double          begin_;
+            double          duration_;
+            /// [us]
+            double          phases_[PHASE_NUMBER];
+            uint64_t        counters_[COUNTER_NUMBER];
+        };
+
+
+    protected:
+        std::atomic<bool>       enabled_;
+        std::atomic<uint64_t>   counters_[COUNTER_NUMBER];
+
+        std::mutex              mutex_;
+        Clock::time_point       start_time_;
+        bool                    frame_open_;
+        Frame                   frame_;
+        Clock::time_point       frame_begin_;
+        uint64_t                frame_counters_[COUNTER_NUMBER];
+        /// counters before the first frame, e.g., nodes allocated at startup
+        uint64_t                setup_counters_[COUNTER_NUMBER];
+        bool                    setup_done_;
+
+        std::vector<Frame>      frames_;
+        std::vector<Event>      events_;
+        std::map<std::thread::id, std::size_t>  threads_;
+
+
+    protected:
+        FrameProfiler() : enabled_(false)
+        {
+            for (std::size_t i = 0; i < COUNTER_NUMBER; ++i)
+            {
+                counters_[i] = 0;
+                frame_counters_[i] = 0;
+                setup_counters_[i] = 0;
+            }
+            frame_open_ = false;
+            setup_done_ = false;
+            start_time_ = Clock::now();
+        }
+
+
+        double getTime(const Clock::time_point & time) const
+        {
+            return (std::chrono::duration<double, std::micro>(time - start_time_).count());
+        }
+
+
+        static const char * getPhaseName(const std::size_t phase)
+        {
+            static const char * names[PHASE_NUMBER] = {"shapes", "read", "wait", "update", "cull", "draw", "snapshot"};
+            return (names[phase]);
+        }
+
+
+        static const char * getCounterName(const std::size_t counter)
+        {
+            static const char * names[COUNTER_NUMBER] = {"bytes_parsed", "nodes_allocated", "images_written"};
+            return (names[counter]);
+        }
+
+
+        /**
+         * @brief Must be called with locked mutex_.
+         */
+        void closeFrame(const Clock::time_point & end_time)
+        {
+            frame_.duration_ = getTime(end_time) - frame_.begin_;
+            for (std::size_t i = 0; i < COUNTER_NUMBER; ++i)
+            {
+                const uint64_t counter = counters_[i].load(std::memory_order_relaxed);
+                frame_.counters_[i] = counter - frame_counters_[i];
+                frame_counters_[i] = counter;
+            }
+            frames_.push_back(frame_);
+            frame_open_ = false;
+        }
+
+
+        static double getPercentile(const std::vector<double> & sorted_values, const double percentile)
+        {
+            return (sorted_values[std::min(sorted_values.size() - 1,
+                                           static_cast<std::size_t>(percentile * sorted_values.size()))]);
+        }
+
+
+    public:
+        static FrameProfiler & getInstance()
+        {
+            static FrameProfiler profiler;
+            return (profiler);
+        }
+
+
+        static bool isEnabled()
+        {
+            return (getInstance().enabled_.load(std::memory_order_relaxed));
+        }
+
+
+        static void count(const Counter counter, const uint64_t value)
+        {
+            FrameProfiler & profiler = getInstance();
+            if (profiler.enabled_.load(std::memory_order_relaxed))
+            {
+                profiler.counters_[counter].fetch_add(value, std::memory_order_relaxed);
+            }
+        }
+
+
+        /**
+         * @brief Must be called before other threads are started.
+         */
+        void enable()
+        {
+            start_time_ = Clock::now();
+            enabled_ = true;
+        }
+
+
+        /**
+         * @brief Starts a frame, the previous frame is closed.
+         */
+        void beginFrame(const std::ptrdiff_t iteration)
+        {
+            if (!isEnabled())
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            const Clock::time_point now = Clock::now();
+
+            if (frame_open_)
+            {
+                closeFrame(now);
+            }
+            if (!setup_done_)
+            {
+                for (std::size_t i = 0; i < COUNTER_NUMBER; ++i)
+                {
+                    setup_counters_[i] = counters_[i].load(std::memory_order_relaxed);
+                    frame_counters_[i] = setup_counters_[i];
+                }
+                setup_done_ = true;
+            }
+
+            frame_.iteration_ = iteration;
+            frame_.begin_ = getTime(now);
+            std::fill(frame_.phases_, frame_.phases_ + PHASE_NUMBER, 0.0);
+            frame_begin_ = now;
+            frame_open_ = true;
+        }
+
+
+        void endFrame()
+        {
+            if (!isEnabled())
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (frame_open_)
+            {
+                closeFrame(Clock::now());
+            }
+        }
+
+
+        /**
+         * @brief Time of the beginning of the current frame.
+         */
+        Clock::time_point getFrameBegin() const
+        {
+            return (frame_begin_);
+        }
+
+
+        void addPhase(  const Phase phase,
+                        const Clock::time_point & begin,
+                        const Clock::time_point & end)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            Event event;
+            event.phase_ = phase;
+            event.begin_ = getTime(begin);
+            event.duration_ = std::chrono::duration<double, std::micro>(end - begin).count();
+
+            std::map<std::thread::id, std::size_t>::iterator thread =
+                threads_.insert(std::make_pair(std::this_thread::get_id(), threads_.size())).first;
+            event.thread_ = thread->second;
+
+            events_.push_back(event);
+            if (frame_open_)
+            {
+                frame_.phases_[phase] += event.duration_;
+            }
+        }
+
+
+        /**
+         * @brief Writes complete ('X') events of phases and frames and
+         * counter ('C') events, timestamps are in microseconds.
+         */
+        void writeChromeTrace(const std::string & filename)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            FILE * file = fopen(filename.c_str(), "w");
+            if (NULL == file)
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot open file: " + filename);
+            }
+
+            fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+            fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"main\"}}");
+
+            for (std::size_t i = 0; i < frames_.size(); ++i)
+            {
+                const Frame & frame = frames_[i];
+
+                fprintf(file, ",\n{\"name\": \"frame\", \"cat\": \"frame\", \"ph\": \"X\", \"pid\": 1, \"tid\": 0, "
+                              "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"iteration\": %td}}",
+                        frame.begin_, frame.duration_, frame.iteration_);
+
+                fprintf(file, ",\n{\"name\": \"counters\", \"ph\": \"C\", \"pid\": 1, \"ts\": %.3f, \"args\": {", frame.begin_);
+                for (std::size_t j = 0; j < COUNTER_NUMBER; ++j)
+                {
+                    fprintf(file, "%s\"%s\": %llu", (0 == j ? "" : ", "), getCounterName(j),
+                            static_cast<unsigned long long>(frame.counters_[j]));
+                }
+                fprintf(file, "}}");
+            }
+
+            for (std::size_t i = 0; i < events_.size(); ++i)
+            {
+                const Event & event = events_[i];
+
+                fprintf(file, ",\n{\"name\": \"%s\", \"cat\": \"phase\", \"ph\": \"X\", \"pid\": 1, \"tid\": %zu, "
+                              "\"ts\": %.3f, \"dur\": %.3f}",
+                        getPhaseName(event.phase_), event.thread_, event.begin_, event.duration_);
+            }
+
+            fprintf(file, "\n]}\n");
+            fclose(file);
+        }
+
+
+        /**
+         * @brief Writes a row per frame: iteration, begin and duration of the
+         * frame, durations of the phases [ms], and counters.
+         */
+        void writeCSV(const std::string & filename)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            FILE * file = fopen(filename.c_str(), "w");
+            if (NULL == file)
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot open file: " + filename);
+            }
+
+            fprintf(file, "iteration,begin_ms,frame_ms");
+            for (std::size_t i = 0; i < PHASE_NUMBER; ++i)
+            {
+                fprintf(file, ",%s_ms", getPhaseName(i));
+            }
+            for (std::size_t i = 0; i < COUNTER_NUMBER; ++i)
+            {
+                fprintf(file, ",%s", getCounterName(i));
+            }
+            fprintf(file, "\n");
+
+            for (std::size_t i = 0; i < frames_.size(); ++i)
+            {
+                const Frame & frame = frames_[i];
+
+                fprintf(file, "%td,%.3f,%.3f", frame.iteration_, frame.begin_ * 1e-3, frame.duration_ * 1e-3);
+                for (std::size_t j = 0; j < PHASE_NUMBER; ++j)
+                {
+                    fprintf(file, ",%.3f", frame.phases_[j] * 1e-3);
+                }
+                for (std::size_t j = 0; j < COUNTER_NUMBER; ++j)
+                {
+                    fprintf(file, ",%llu", static_cast<unsigned long long>(frame.counters_[j]));
+                }
+                fprintf(file, "\n");
+            }
+
+            fclose(file);
+        }
+
+
+        void printSummary()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            if (frames_.empty())
+            {
+                return;
+            }
+
+            std::cout << "Frame phases [ms] over " << frames_.size() << " frames:" << std::endl;
+            std::cout << std::setw(10) << "phase" << std::setw(10) << "p50" << std::setw(10) << "p90"
+                      << std::setw(10) << "p99" << std::setw(10) << "max" << std::setw(12) << "total" << std::endl;
+
+            std::vector<double> values(frames_.size());
+            for (std::size_t i = 0; i <= PHASE_NUMBER; ++i)
+            {
+                for (std::size_t j = 0; j < frames_.size(); ++j)
+                {
+                    values[j] = (PHASE_NUMBER == i ? frames_[j].duration_ : frames_[j].phases_[i]) * 1e-3;
+                }
+                const double total = std::accumulate(values.begin(), values.end(), 0.0);
+                std::sort(values.begin(), values.end());
+
+                std::cout << std::setw(10) << (PHASE_NUMBER == i ? "frame" : getPhaseName(i))
+                          << std::fixed << std::setprecision(3)
+                          << std::setw(10) << getPercentile(values, 0.5)
+                          << std::setw(10) << getPercentile(values, 0.9)
+                          << std::setw(10) << getPercentile(values, 0.99)
+                          << std::setw(10) << values.back()
+                          << std::setw(12) << total << std::endl;
+            }
+            std::cout.unsetf(std::ios::floatfield);
+
+            for (std::size_t i = 0; i < COUNTER_NUMBER; ++i)
+            {
+                uint64_t total = 0;
+                for (std::size_t j = 0; j < frames_.size(); ++j)
+                {
+                    total += frames_[j].counters_[i];
+                }
+                // e.g., images are written after the last frame
+                std::cout << "Counter " << getCounterName(i) << ": " << counters_[i].load() << " total, "
+                          << setup_counters_[i] << " at startup, "
+                          << static_cast<double>(total) / frames_.size() << " per frame" << std::endl;
+            }
+        }
+};
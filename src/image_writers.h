@@ -0,0 +1,463 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Consumers of screenshots: image files and video streams.
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include <iomanip>
+#include <sstream>
+#include <deque>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+#include "frame_profiler.h"
+
+
+/**
+ * @brief Bounded queue of images processed by worker threads.
+ *
+ * push() blocks when max_queue_size images are waiting. Derived classes
+ * must call start() in their constructors and stop() in their destructors.
+ */
+class ImageWriter : public osg::Referenced
+{
+    protected:
+        struct Job
+        {
+            osg::ref_ptr<osg::Image>    image_;
+            std::size_t                 index_;
+        };
+
+
+    protected:
+        std::deque<Job>             jobs_;
+        std::vector<std::thread>    threads_;
+        std::size_t                 max_queue_size_;
+        std::size_t                 active_jobs_;
+        bool                        stop_;
+
+        std::mutex                  mutex_;
+        std::condition_variable     job_added_;
+        std::condition_variable     job_taken_;
+        std::condition_variable     job_finished_;
+
+
+    protected:
+        /**
+         * @brief Processes an image, called by worker threads.
+         */
+        virtual void write(const Job & job) = 0;
+
+
+        void work()
+        {
+            for (;;)
+            {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+
+                    while ((!stop_) && jobs_.empty())
+                    {
+                        job_added_.wait(lock);
+                    }
+                    if (jobs_.empty())
+                    {
+                        return;
+                    }
+
+                    job = jobs_.front();
+                    jobs_.pop_front();
+                    ++active_jobs_;
+                }
+                job_taken_.notify_one();
+
+
+                write(job);
+                FrameProfiler::count(FrameProfiler::IMAGES_WRITTEN, 1);
+
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    --active_jobs_;
+                }
+                job_finished_.notify_all();
+            }
+        }
+
+
+        void start(const std::size_t thread_number)
+        {
+            for (std::size_t i = 0; i < std::max(thread_number, static_cast<std::size_t>(1)); ++i)
+            {
+                threads_.push_back(std::thread(&ImageWriter::work, this));
+            }
+        }
+
+
+        /**
+         * @brief Processes the remaining images and joins the threads.
+         */
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            job_added_.notify_all();
+
+            for (std::size_t i = 0; i < threads_.size(); ++i)
+            {
+                threads_[i].join();
+            }
+            threads_.clear();
+        }
+
+
+    public:
+        ImageWriter(const std::size_t max_queue_size)
+        {
+            max_queue_size_ = std::max(max_queue_size, static_cast<std::size_t>(1));
+            active_jobs_ = 0;
+            stop_ = false;
+        }
+
+
+        void push(  osg::ref_ptr<osg::Image> image,
+                    const std::size_t index)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+
+                while (jobs_.size() >= max_queue_size_)
+                {
+                    job_taken_.wait(lock);
+                }
+
+                Job job;
+                job.image_ = image;
+                job.index_ = index;
+                jobs_.push_back(job);
+            }
+            job_added_.notify_one();
+        }
+
+
+        /**
+         * @brief Blocks until all queued images are processed.
+         */
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+
+            while ((!jobs_.empty()) || (active_jobs_ > 0))
+            {
+                job_finished_.wait(lock);
+            }
+        }
+};
+
+
+
+/**
+ * @brief Writes each image to a separate file using a pool of threads,
+ * files are written in arbitrary order.
+ */
+class ImageFileWriter : public ImageWriter
+{
+    protected:
+        std::string     filename_prefix_;
+        std::string     filename_suffix_;
+        std::mutex      output_mutex_;
+
+
+    protected:
+        void write(const Job & job)
+        {
+            std::stringstream filename;
+            filename    << filename_prefix_
+                        << std::setw(10) << std::setfill('0') << job.index_
+                        << filename_suffix_;
+
+            if (osgDB::writeImageFile(*job.image_, filename.str()))
+            {
+                std::lock_guard<std::mutex> lock(output_mutex_);
+                std::cout  << "Saved screen image to `"<< filename.str() <<"`"<< std::endl;
+            }
+        }
+
+
+    public:
+        ImageFileWriter(const std::string & filename_prefix,
+                        const std::string & filename_suffix,
+                        const std::size_t thread_number,
+                        const std::size_t max_queue_size)
+            : ImageWriter(max_queue_size)
+        {
+            filename_prefix_ = filename_prefix;
+            filename_suffix_ = filename_suffix;
+
+            start(thread_number);
+        }
+
+
+        ~ImageFileWriter()
+        {
+            stop();
+        }
+};
+
+
+
+/**
+ * @brief Writes all images to a single video stream in one thread, which
+ * preserves the order of frames.
+ *
+ * Supported formats:
+ *  - Y4M: uncompressed YUV 4:4:4 stream written to a file;
+ *  - FFMPEG: raw RGB frames are piped to an ffmpeg process, which encodes
+ *    them with H.264 (same settings as video_output/Makefile).
+ *
+ * Frames must have the same size as the first frame, other frames are
+ * skipped.
+ */
+class VideoStreamWriter : public ImageWriter
+{
+    public:
+        enum Format
+        {
+            Y4M = 0,
+            FFMPEG = 1
+        };
+
+
+    protected:
+        Format                      format_;
+        std::string                 filename_;
+        std::size_t                 frame_rate_;
+
+        FILE *                      stream_;
+        bool                        opened_;
+        /// writing to the stream failed, e.g., the encoder exited
+        bool                        failed_;
+        int                         width_;
+        int                         height_;
+        std::size_t                 frame_counter_;
+        std::vector<unsigned char>  buffer_;
+
+
+    protected:
+        /**
+         * @brief Quotes a string for the shell.
+         */
+        static std::string quote(const std::string & string)
+        {
+            std::string quoted = "'";
+            for (std::size_t i = 0; i < string.size(); ++i)
+            {
+                if ('\'' == string[i])
+                {
+                    quoted += "'\\''";
+                }
+                else
+                {
+                    quoted += string[i];
+                }
+            }
+            quoted += "'";
+            return (quoted);
+        }
+
+
+        void open(const osg::Image & image)
+        {
+            width_ = image.s();
+            height_ = image.t();
+
+            if (FFMPEG == format_)
+            {
+                std::stringstream command;
+                command << "ffmpeg -y -loglevel error -f rawvideo -pixel_format rgb24"
+                        << " -video_size " << width_ << "x" << height_
+                        << " -framerate " << frame_rate_
+                        << " -i - -vcodec libx264 -pix_fmt yuv420p " << quote(filename_);
+
+                stream_ = popen(command.str().c_str(), "w");
+            }
+            else
+            {
+                stream_ = fopen(filename_.c_str(), "wb");
+                if (NULL != stream_)
+                {
+                    fprintf(stream_, "YUV4MPEG2 W%d H%d F%lu:1 Ip A1:1 C444\n",
+                            width_, height_, static_cast<unsigned long>(frame_rate_));
+                }
+            }
+
+            if (NULL == stream_)
+            {
+                std::cout << "Cannot open video stream `" << filename_ << "`" << std::endl;
+            }
+        }
+
+
+        void convertToRGB(const osg::Image & image)
+        {
+            const std::size_t row_size = width_ * 3;
+
+            // OpenGL images are stored bottom-up
+            buffer_.resize(row_size * height_);
+            for (int i = 0; i < height_; ++i)
+            {
+                const unsigned char * row = image.data() + (height_ - 1 - i) * row_size;
+                std::copy(row, row + row_size, buffer_.begin() + i * row_size);
+            }
+        }
+
+
+        void convertToYUV444(const osg::Image & image)
+        {
+            const std::size_t plane_size = width_ * height_;
+
+            buffer_.resize(plane_size * 3);
+            unsigned char * y_plane = &buffer_[0];
+            unsigned char * u_plane = y_plane + plane_size;
+            unsigned char * v_plane = u_plane + plane_size;
+
+            // BT.601, limited range
+            for (int i = 0; i < height_; ++i)
+            {
+                const unsigned char * pixel = image.data() + (height_ - 1 - i) * width_ * 3;
+                for (int j = 0; j < width_; ++j, pixel += 3)
+                {
+                    const int r = pixel[0];
+                    const int g = pixel[1];
+                    const int b = pixel[2];
+
+                    *(y_plane++) = ((66*r + 129*g + 25*b + 128) >> 8) + 16;
+                    *(u_plane++) = ((-38*r - 74*g + 112*b + 128) >> 8) + 128;
+                    *(v_plane++) = ((112*r - 94*g - 18*b + 128) >> 8) + 128;
+                }
+            }
+        }
+
+
+        void write(const Job & job)
+        {
+            const osg::Image & image = *job.image_;
+
+            if (!opened_)
+            {
+                open(image);
+                opened_ = true;
+            }
+            // nothing is written to a broken stream
+            if ((NULL == stream_) || failed_)
+            {
+                return;
+            }
+
+            if ((image.s() != width_) || (image.t() != height_))
+            {
+                std::cout << "Skipped frame " << job.index_ << " of different size in video stream `"
+                          << filename_ << "`" << std::endl;
+                return;
+            }
+
+
+            bool written = true;
+            if (FFMPEG == format_)
+            {
+                convertToRGB(image);
+            }
+            else
+            {
+                convertToYUV444(image);
+                written = (EOF != fputs("FRAME\n", stream_));
+            }
+            if ((!written) || (buffer_.size() != fwrite(&buffer_[0], 1, buffer_.size(), stream_)))
+            {
+                std::cout << "Failed to write frame " << job.index_ << " to video stream `" << filename_ << "`"
+                          << (FFMPEG == format_ ? ", check that ffmpeg is installed" : "") << std::endl;
+                failed_ = true;
+                return;
+            }
+
+            ++frame_counter_;
+        }
+
+
+    public:
+        /**
+         * @param[in] filename_prefix   '.mp4' or '.y4m' is appended
+         */
+        VideoStreamWriter(  const Format format,
+                            const std::string & filename_prefix,
+                            const std::size_t frame_rate,
+                            const std::size_t max_queue_size)
+            : ImageWriter(max_queue_size)
+        {
+            format_ = format;
+            filename_ = filename_prefix + (FFMPEG == format ? ".mp4" : ".y4m");
+            frame_rate_ = std::max(frame_rate, static_cast<std::size_t>(1));
+
+            stream_ = NULL;
+            opened_ = false;
+            failed_ = false;
+            width_ = 0;
+            height_ = 0;
+            frame_counter_ = 0;
+
+            if (FFMPEG == format_)
+            {
+                // if ffmpeg exits, writing to the pipe must fail instead of
+                // terminating the visualizer
+                signal(SIGPIPE, SIG_IGN);
+            }
+
+            start(1);
+        }
+
+
+        ~VideoStreamWriter()
+        {
+            stop();
+
+            if (NULL != stream_)
+            {
+                bool success = !failed_;
+                if (FFMPEG == format_)
+                {
+                    const int status = pclose(stream_);
+                    success = success && (-1 != status) && WIFEXITED(status) && (0 == WEXITSTATUS(status));
+                }
+                else
+                {
+                    success = (0 == fclose(stream_)) && success;
+                }
+
+                if (success)
+                {
+                    std::cout << "Saved " << frame_counter_ << " frames to `" << filename_ << "`" << std::endl;
+                }
+                else
+                {
+                    std::cout << "Failed to save video stream `" << filename_ << "`, "
+                              << frame_counter_ << " frames were written" << std::endl;
+                }
+            }
+        }
+};
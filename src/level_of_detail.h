@@ -0,0 +1,135 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Generation of decimated meshes for osg::LOD.
+*/
+
+#pragma once
+
+#include <vector>
+#include <string>
+
+
+/**
+ * @brief Levels of detail of body meshes, read from the 'level_of_detail'
+ * section of a robot description:
+ *
+ *      level_of_detail:
+ *        range_mode: distance      # or 'pixel_size'
+ *        levels:
+ *          - {ratio: 1.0, min: 0, max: 5}
+ *          - {ratio: 0.2, min: 5, max: 1e10}
+ *
+ * ratio is the fraction of vertices kept by the simplifier, min and max
+ * define the range of distances to the eye point (or of the sizes of the
+ * mesh on screen in pixels), in which the level is displayed.
+ */
+class LevelOfDetail
+{
+    public:
+        struct Level
+        {
+            double  ratio_;
+            float   min_;
+            float   max_;
+        };
+
+
+    public:
+        osg::LOD::RangeMode     range_mode_;
+        std::vector<Level>      levels_;
+
+
+    public:
+        LevelOfDetail()
+        {
+            range_mode_ = osg::LOD::DISTANCE_FROM_EYE_POINT;
+        }
+
+
+        void read(const YAML::Node & config)
+        {
+            levels_.clear();
+
+            if (config["range_mode"])
+            {
+                const std::string range_mode = config["range_mode"].as<std::string>();
+                if ("distance" == range_mode)
+                {
+                    range_mode_ = osg::LOD::DISTANCE_FROM_EYE_POINT;
+                }
+                else if ("pixel_size" == range_mode)
+                {
+                    range_mode_ = osg::LOD::PIXEL_SIZE_ON_SCREEN;
+                }
+                else
+                {
+                    throw std::runtime_error(std::string("In ") + __func__ + "() // Unknown range mode of levels of detail: " + range_mode);
+                }
+            }
+
+            if (!config["levels"])
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // " + ("Levels of detail must be specified."));
+            }
+
+            const YAML::Node levels = config["levels"];
+            for (std::size_t i = 0; i < levels.size(); ++i)
+            {
+                Level level;
+
+                level.ratio_ = levels[i]["ratio"].as<double>();
+                level.min_ = levels[i]["min"].as<float>();
+                level.max_ = levels[i]["max"].as<float>();
+
+                if ((level.ratio_ <= 0.0) || (level.ratio_ > 1.0) || (level.min_ > level.max_))
+                {
+                    throw std::runtime_error(std::string("In ") + __func__ + "() // " + ("Wrong level of detail: ratio must be in (0, 1], min must not exceed max."));
+                }
+
+                levels_.push_back(level);
+            }
+        }
+
+
+        bool isEnabled() const
+        {
+            return (!levels_.empty());
+        }
+
+
+        /**
+         * @brief Creates an LOD node with decimated copies of a mesh, the
+         * mesh itself is used for levels with ratio 1. Geometry is copied,
+         * state (materials, textures) is shared with the original mesh.
+         */
+        osg::ref_ptr<osg::Node> create(osg::ref_ptr<osg::Node> mesh) const
+        {
+            osg::ref_ptr<osg::LOD> lod = new osg::LOD;
+            lod->setRangeMode(range_mode_);
+
+            for (std::size_t i = 0; i < levels_.size(); ++i)
+            {
+                osg::ref_ptr<osg::Node> level_mesh = mesh;
+
+                if (levels_[i].ratio_ < 1.0)
+                {
+                    level_mesh = dynamic_cast<osg::Node *>(mesh->clone(
+                                osg::CopyOp::DEEP_COPY_NODES
+                                | osg::CopyOp::DEEP_COPY_DRAWABLES
+                                | osg::CopyOp::DEEP_COPY_ARRAYS
+                                | osg::CopyOp::DEEP_COPY_PRIMITIVES));
+
+                    osgUtil::Simplifier simplifier(levels_[i].ratio_);
+                    level_mesh->accept(simplifier);
+                }
+
+                lod->addChild(level_mesh.get(), levels_[i].min_, levels_[i].max_);
+            }
+
+            return (lod);
+        }
+};
@@ -0,0 +1,257 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Cache of mesh files shared by bodies and robots.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <map>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+
+/**
+ * @brief Loads each unique mesh once and shares the resulting osg::Node.
+ *
+ * Meshes are identified by their content (size and FNV-1a hash of the file)
+ * and the reader options, so copies of the same file under different names
+ * are loaded once as well. Unique meshes of a batch are parsed in parallel.
+ *
+ * Assembled scenes of robots are kept as well, so that robots with the same
+ * description share them, see Robot::load().
+ */
+class MeshCache : public osg::Referenced
+{
+    protected:
+        struct Request
+        {
+            std::string             path_;
+            std::string             key_;
+            osg::ref_ptr<osg::Node> node_;
+        };
+
+
+    protected:
+        std::size_t     thread_number_;
+
+        /// path + options -> content key
+        std::map<std::string, std::string>                  keys_;
+        /// content key + options -> mesh, NULL if loading failed
+        std::map<std::string, osg::ref_ptr<osg::Node> >     nodes_;
+        /// robot description file -> robot scene
+        std::map<std::string, osg::ref_ptr<osg::Group> >    robot_scenes_;
+
+        std::size_t     request_counter_;
+        std::size_t     load_counter_;
+        double          load_time_;
+
+
+    protected:
+        /**
+         * @brief Returns a key identifying the content of a file, or the
+         * path itself if the file cannot be read.
+         */
+        static std::string getContentKey(const std::string & path)
+        {
+            FILE * file = fopen(path.c_str(), "rb");
+            if (NULL == file)
+            {
+                return (std::string("path:") + path);
+            }
+
+            std::vector<unsigned char>  buffer(1 << 16);
+            uint64_t                    hash = 14695981039346656037ULL;
+            uint64_t                    size = 0;
+
+            for (;;)
+            {
+                const std::size_t read_size = fread(&buffer[0], 1, buffer.size(), file);
+                if (0 == read_size)
+                {
+                    break;
+                }
+
+                for (std::size_t i = 0; i < read_size; ++i)
+                {
+                    hash = (hash ^ buffer[i]) * 1099511628211ULL;
+                }
+                size += read_size;
+            }
+            fclose(file);
+
+            // the extension selects the reader plugin
+            const std::size_t dot = path.find_last_of("./");
+            const std::string extension =
+                ((std::string::npos != dot) && ('.' == path[dot])) ? path.substr(dot) : std::string();
+
+            char key[64];
+            snprintf(key, sizeof(key), "%016llx:%llu",
+                     static_cast<unsigned long long>(hash),
+                     static_cast<unsigned long long>(size));
+
+            return (std::string(key) + extension);
+        }
+
+
+    public:
+        MeshCache(const std::size_t thread_number = std::thread::hardware_concurrency())
+        {
+            thread_number_ = std::max(thread_number, static_cast<std::size_t>(1));
+
+            request_counter_ = 0;
+            load_counter_ = 0;
+            load_time_ = 0.0;
+        }
+
+
+        /**
+         * @brief Calls function(i) for i in [0, size) on a pool of threads.
+         */
+        template <class t_Function>
+            void parallelFor(const std::size_t size, t_Function function) const
+        {
+            std::atomic<std::size_t>    next_index(0);
+            std::vector<std::thread>    threads;
+
+            const std::size_t thread_number = std::min(thread_number_, size);
+            for (std::size_t i = 0; i < thread_number; ++i)
+            {
+                threads.push_back(std::thread(
+                            [&]()
+                            {
+                                for (std::size_t index = next_index++; index < size; index = next_index++)
+                                {
+                                    function(index);
+                                }
+                            }));
+            }
+
+            for (std::size_t i = 0; i < threads.size(); ++i)
+            {
+                threads[i].join();
+            }
+        }
+
+
+        /**
+         * @brief Loads the meshes, which are not in the cache yet.
+         *
+         * @param[in] paths
+         * @param[in] options   reader options, part of the cache key
+         */
+        void load(  const std::vector<std::string> & paths,
+                    osg::ref_ptr<osgDB::Options> options)
+        {
+            const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+            const std::string option_string = options.valid() ? options->getOptionString() : std::string();
+
+
+            // identify files by content
+            std::vector<Request>    requests;
+            for (std::size_t i = 0; i < paths.size(); ++i)
+            {
+                ++request_counter_;
+                if (keys_.find(paths[i] + "|" + option_string) == keys_.end())
+                {
+                    keys_[paths[i] + "|" + option_string] = std::string();
+
+                    Request request;
+                    request.path_ = paths[i];
+                    requests.push_back(request);
+                }
+            }
+
+            parallelFor(requests.size(),
+                        [&](const std::size_t i)
+                        {
+                            requests[i].key_ = getContentKey(requests[i].path_) + "|" + option_string;
+                        });
+
+
+            // parse unique files
+            std::vector<Request *>  unique_requests;
+            for (std::size_t i = 0; i < requests.size(); ++i)
+            {
+                keys_[requests[i].path_ + "|" + option_string] = requests[i].key_;
+
+                if (nodes_.find(requests[i].key_) == nodes_.end())
+                {
+                    nodes_[requests[i].key_] = NULL;
+                    unique_requests.push_back(&requests[i]);
+                }
+            }
+
+            parallelFor(unique_requests.size(),
+                        [&](const std::size_t i)
+                        {
+                            unique_requests[i]->node_ = osgDB::readNodeFile(unique_requests[i]->path_, options.get());
+                        });
+
+            for (std::size_t i = 0; i < unique_requests.size(); ++i)
+            {
+                nodes_[unique_requests[i]->key_] = unique_requests[i]->node_;
+            }
+            load_counter_ += unique_requests.size();
+
+
+            load_time_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        }
+
+
+        /**
+         * @brief Returns a mesh loaded by load() with the same options, NULL
+         * if it could not be loaded.
+         */
+        osg::ref_ptr<osg::Node> get(const std::string & path,
+                                    osg::ref_ptr<osgDB::Options> options) const
+        {
+            const std::string option_string = options.valid() ? options->getOptionString() : std::string();
+
+            std::map<std::string, std::string>::const_iterator key = keys_.find(path + "|" + option_string);
+            if (key == keys_.end())
+            {
+                return (NULL);
+            }
+
+            std::map<std::string, osg::ref_ptr<osg::Node> >::const_iterator node = nodes_.find(key->second);
+            return (node == nodes_.end() ? NULL : node->second);
+        }
+
+
+        void addRobotScene( const std::string & robot_description_file,
+                            osg::ref_ptr<osg::Group> robot_scene)
+        {
+            robot_scenes_[robot_description_file] = robot_scene;
+        }
+
+
+        /**
+         * @brief Returns NULL if the description has not been loaded yet.
+         */
+        osg::ref_ptr<osg::Group> getRobotScene(const std::string & robot_description_file) const
+        {
+            std::map<std::string, osg::ref_ptr<osg::Group> >::const_iterator scene = robot_scenes_.find(robot_description_file);
+            return (scene == robot_scenes_.end() ? NULL : scene->second);
+        }
+
+
+        void printStatistics() const
+        {
+            std::cout << "Mesh cache: " << request_counter_ << " meshes requested, "
+                      << load_counter_ << " files loaded in " << load_time_ * 1000.0 << " ms, "
+                      << robot_scenes_.size() << " robot descriptions" << std::endl;
+        }
+};
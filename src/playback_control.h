@@ -0,0 +1,117 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Keyboard control of playback: pause, reverse, scrubbing.
+*/
+
+#pragma once
+
+
+/**
+ * @brief Selects iterations to display based on keyboard input.
+ *
+ * Keys:
+ *  - p             pause / resume;
+ *  - b             toggle backward playback;
+ *  - Left, Right   step one frame back / forward;
+ *  - Page Down/Up  step 100 frames back / forward;
+ *  - Home          jump to the first frame.
+ */
+class PlaybackControl : public osgGA::GUIEventHandler
+{
+    protected:
+        std::ptrdiff_t  direction_;
+        std::ptrdiff_t  step_request_;
+        bool            paused_;
+        bool            jump_to_start_;
+        bool            changed_;
+
+
+    public:
+        PlaybackControl()
+        {
+            direction_ = 1;
+            step_request_ = 0;
+            paused_ = false;
+            jump_to_start_ = false;
+            changed_ = false;
+        }
+
+
+        virtual bool handle(const osgGA::GUIEventAdapter & event, osgGA::GUIActionAdapter &)
+        {
+            if (osgGA::GUIEventAdapter::KEYDOWN != event.getEventType())
+            {
+                return (false);
+            }
+
+            switch (event.getKey())
+            {
+                case 'p':
+                    paused_ = !paused_;
+                    break;
+                case 'b':
+                    direction_ = -direction_;
+                    break;
+                case osgGA::GUIEventAdapter::KEY_Left:
+                    step_request_ -= 1;
+                    break;
+                case osgGA::GUIEventAdapter::KEY_Right:
+                    step_request_ += 1;
+                    break;
+                case osgGA::GUIEventAdapter::KEY_Page_Down:
+                    step_request_ -= 100;
+                    break;
+                case osgGA::GUIEventAdapter::KEY_Page_Up:
+                    step_request_ += 100;
+                    break;
+                case osgGA::GUIEventAdapter::KEY_Home:
+                    jump_to_start_ = true;
+                    break;
+                default:
+                    return (false);
+            }
+
+            changed_ = true;
+            return (true);
+        }
+
+
+        /**
+         * @brief Returns the iteration to display after the given one.
+         */
+        std::ptrdiff_t getNextIteration(const std::ptrdiff_t iteration)
+        {
+            std::ptrdiff_t next_iteration = iteration + step_request_ + (paused_ ? 0 : direction_);
+
+            if (jump_to_start_)
+            {
+                next_iteration = 0;
+                jump_to_start_ = false;
+            }
+            step_request_ = 0;
+
+            return (std::max(next_iteration, static_cast<std::ptrdiff_t>(0)));
+        }
+
+
+        /**
+         * @brief True (once) if playback was paused, reversed or scrubbed
+         * since the last call.
+         */
+        bool checkChanged()
+        {
+            const bool changed = changed_;
+            changed_ = false;
+            return (changed);
+        }
+
+
+        std::ptrdiff_t getDirection() const
+        {
+            return (direction_);
+        }
+};
@@ -0,0 +1,1594 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Sources of body poses.
+*/
+
+#pragma once
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <poll.h>
+
+#include <cmath>
+#include <limits>
+#include <fstream>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <exception>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+
+#include "binary_trajectory.h"
+#include "compressed_trajectory.h"
+#include "shared_memory_poses.h"
+#include "text_scanner.h"
+#include "frame_index.h"
+#include "frame_profiler.h"
+
+
+/**
+ * @brief Provides frames of poses, each frame contains 6 values (XYZ-RPY)
+ * per body.
+ */
+class PoseSource : public osg::Referenced
+{
+    protected:
+        bool eof_;
+
+
+    public:
+        /// time of the last frame, if provided by the source
+        double  timestamp_;
+
+
+    public:
+        PoseSource()
+        {
+            eof_ = false;
+            timestamp_ = 0.0;
+        }
+
+
+        /**
+         * @brief Reads the next frame.
+         *
+         * @param[out] poses    6 values per body, must be preallocated.
+         *
+         * @return false if no frame was read.
+         */
+        virtual bool readFrame(std::vector<double> & poses) = 0;
+
+
+        /**
+         * @brief True after an attempt to read past the last frame.
+         */
+        bool eof() const
+        {
+            return (eof_);
+        }
+
+
+        /**
+         * @brief True if seek() is supported.
+         */
+        virtual bool isSeekable() const
+        {
+            return (false);
+        }
+
+
+        /**
+         * @brief Positions the source, so that the next call to readFrame()
+         * returns the given frame.
+         */
+        virtual void seek(const std::size_t)
+        {
+            throw std::runtime_error(std::string("In ") + __func__ + "() // Seeking is not supported by the data source.");
+        }
+
+
+        /**
+         * @brief Skips the next frame, sources override it to avoid parsing.
+         *
+         * @param[out] buffer   6 values per body, may be overwritten
+         *
+         * @return false if there is no frame to skip.
+         */
+        virtual bool skipFrame(std::vector<double> & buffer)
+        {
+            return (readFrame(buffer));
+        }
+
+
+        virtual void printStatistics() const
+        {
+        }
+};
+
+
+
+#define COMPRESSED_POSE_SOURCE_MAX_THREADS 4U
+#define POSE_SOURCE_MAX_SKIPPED_FRAMES 256
+
+/**
+ * @brief Prepares a source to read the given frame next: short forward jumps
+ * (e.g., due to resampling) are skipped without parsing, other jumps use
+ * seek() if it is supported.
+ *
+ * @param[in,out] source
+ * @param[in] next_frame    frame, which would be read next by the source
+ * @param[in] frame         frame, which must be read next
+ * @param[out] buffer       6 values per body, may be overwritten
+ */
+void moveToFrame(   PoseSource & source,
+                    const std::ptrdiff_t next_frame,
+                    const std::ptrdiff_t frame,
+                    std::vector<double> & buffer)
+{
+    if ((frame > next_frame) && (frame - next_frame <= POSE_SOURCE_MAX_SKIPPED_FRAMES))
+    {
+        for (std::ptrdiff_t i = next_frame; (i < frame) && source.skipFrame(buffer); ++i);
+    }
+    else if ((frame != next_frame) && (source.isSeekable()))
+    {
+        source.seek(frame);
+    }
+}
+
+
+
+/**
+ * @brief Text files, one frame per line, optionally preceded by a timestamp.
+ */
+class TextPoseSource : public PoseSource
+{
+    protected:
+        std::string     data_file_;
+        std::string     line_;
+        std::size_t     line_number_;
+        bool            timestamp_column_;
+
+        /// built on the first seek
+        std::unique_ptr<FrameIndex> frame_index_;
+
+
+    public:
+        std::ifstream   file_stream_;
+
+
+    public:
+        /**
+         * @brief Parses a line of a data file.
+         *
+         * @param[in] line  null terminated
+         * @param[out] poses
+         * @param[in] line_number   used in error messages
+         * @param[in] data_file     used in error messages
+         * @param[in] timestamp_column  if true, the first value is a timestamp
+         * @param[out] timestamp
+         *
+         * @throw std::runtime_error if the line contains a malformed value or
+         * a wrong number of values.
+         */
+        static void parseLine(  const char * line,
+                                std::vector<double> & poses,
+                                const std::size_t line_number,
+                                const std::string & data_file,
+                                const bool timestamp_column,
+                                double & timestamp)
+        {
+            const char * cursor = line;
+            std::size_t parsed_number = 0;
+
+            if (timestamp_column)
+            {
+                TextScanner::skipSpaces(cursor);
+                if (!TextScanner::scanDouble(cursor, timestamp))
+                {
+                    throw std::runtime_error(std::string("In ") + __func__ + "() // Malformed timestamp in line "
+                            + std::to_string(line_number) + " in file: " + data_file);
+                }
+            }
+
+            switch (TextScanner::scanLine(cursor, poses.data(), poses.size(), parsed_number))
+            {
+                case TextScanner::OK:
+                    return;
+
+                case TextScanner::MALFORMED_VALUE:
+                    throw std::runtime_error(std::string("In ") + __func__ + "() // Malformed value in column "
+                            + std::to_string(parsed_number + 1 + (timestamp_column ? 1 : 0))
+                            + " of line " + std::to_string(line_number) + " in file: " + data_file);
+
+                case TextScanner::TOO_MANY_VALUES:
+                    throw std::runtime_error(std::string("In ") + __func__ + "() // More than "
+                            + std::to_string(poses.size()) + " values in line " + std::to_string(line_number)
+                            + " in file: " + data_file);
+
+                case TextScanner::TOO_FEW_VALUES:
+                default:
+                    throw std::runtime_error(std::string("In ") + __func__ + "() // Expected "
+                            + std::to_string(poses.size()) + " values, found " + std::to_string(parsed_number)
+                            + " in line " + std::to_string(line_number) + " in file: " + data_file);
+            }
+        }
+
+
+        /**
+         * @param[in] data_file
+         * @param[in] timestamp_column  if true, the first value in each line
+         *                              is stored in timestamp_
+         */
+        TextPoseSource( const std::string & data_file,
+                        const bool timestamp_column = false)
+        {
+            data_file_ = data_file;
+            line_number_ = 0;
+            timestamp_column_ = timestamp_column;
+            file_stream_.open(data_file.c_str());
+        }
+
+
+        /**
+         * @throw std::runtime_error if a line contains a malformed value or
+         * a wrong number of values.
+         */
+        bool readFrame(std::vector<double> & poses)
+        {
+            // line_ keeps its capacity, no allocations after the first lines
+            while (getline(file_stream_, line_))
+            {
+                ++line_number_;
+                FrameProfiler::count(FrameProfiler::BYTES_PARSED, line_.size() + 1);
+
+                const char * cursor = line_.c_str();
+                TextScanner::skipSpaces(cursor);
+                if ('\0' != *cursor)
+                {
+                    parseLine(line_.c_str(), poses, line_number_, data_file_, timestamp_column_, timestamp_);
+                    return (true);
+                }
+            }
+
+            eof_ = file_stream_.eof();
+            return (false);
+        }
+
+
+        bool skipFrame(std::vector<double> &)
+        {
+            // skip blank lines in the same way as readFrame()
+            for (;;)
+            {
+                const int c = file_stream_.peek();
+                if (std::char_traits<char>::eof() == c)
+                {
+                    eof_ = file_stream_.eof();
+                    return (false);
+                }
+                if (!TextScanner::isSpace(c))
+                {
+                    break;
+                }
+
+                file_stream_.get();
+                if ('\n' == c)
+                {
+                    ++line_number_;
+                }
+            }
+
+            file_stream_.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            ++line_number_;
+            return (true);
+        }
+
+
+        bool isSeekable() const
+        {
+            return (true);
+        }
+
+
+        void seek(const std::size_t frame_index)
+        {
+            if (!frame_index_)
+            {
+                frame_index_.reset(new FrameIndex(data_file_));
+            }
+
+            file_stream_.clear();
+            if (frame_index < frame_index_->getFrameNumber())
+            {
+                file_stream_.seekg(frame_index_->offsets_[frame_index]);
+                // the number of lines before the frame, including blank lines
+                line_number_ = frame_index_->line_indices_[frame_index];
+            }
+            else
+            {
+                file_stream_.seekg(0, std::ios::end);
+            }
+            eof_ = false;
+        }
+};
+
+
+
+/**
+ * @brief Memory mapped binary files, see binary_trajectory.h.
+ */
+class BinaryPoseSource : public PoseSource
+{
+    public:
+        BinaryTrajectoryFile        trajectory_;
+        std::vector<std::size_t>    columns_;
+        std::size_t                 frame_index_;
+
+
+    public:
+        BinaryPoseSource(   const std::string & data_file,
+                            const std::vector<std::string> & body_names)
+            : trajectory_(data_file)
+        {
+            columns_ = trajectory_.getColumns(body_names);
+            frame_index_ = 0;
+        }
+
+
+        bool readFrame(std::vector<double> & poses)
+        {
+            if (frame_index_ < trajectory_.header_->frame_number_)
+            {
+                trajectory_.readFrame(frame_index_, columns_, poses.data());
+                ++frame_index_;
+                return (true);
+            }
+            else
+            {
+                eof_ = true;
+                return (false);
+            }
+        }
+
+
+        bool skipFrame(std::vector<double> &)
+        {
+            if (frame_index_ < trajectory_.header_->frame_number_)
+            {
+                ++frame_index_;
+                return (true);
+            }
+            else
+            {
+                eof_ = true;
+                return (false);
+            }
+        }
+
+
+        bool isSeekable() const
+        {
+            return (true);
+        }
+
+
+        void seek(const std::size_t frame_index)
+        {
+            frame_index_ = frame_index;
+            eof_ = false;
+        }
+};
+
+
+
+/**
+ * @brief Compressed files, see compressed_trajectory.h. Chunks following
+ * the current one are decoded ahead of playback by a pool of threads.
+ */
+class CompressedPoseSource : public PoseSource
+{
+    protected:
+        std::string                 name_;
+        CompressedTrajectoryFile    trajectory_;
+        std::vector<std::size_t>    columns_;
+        std::size_t                 frame_index_;
+
+        /// decoded chunk, which contains frame_index_
+        std::size_t                 chunk_index_;
+        std::vector<double>         chunk_;
+
+        /// number of chunks decoded ahead
+        std::size_t                 depth_;
+
+        mutable std::mutex          mutex_;
+        std::condition_variable     condition_;
+        /// decoded chunks in [window_begin_, window_begin_ + depth_)
+        std::map<std::size_t, std::vector<double> > decoded_;
+        /// chunks, which are being decoded
+        std::vector<std::size_t>    pending_;
+        std::size_t                 window_begin_;
+        bool                        stop_;
+        std::exception_ptr          error_;
+
+        std::vector<std::thread>    threads_;
+
+
+    protected:
+        std::size_t getWindowEnd() const
+        {
+            return (std::min(window_begin_ + depth_, trajectory_.header_->getChunkNumber()));
+        }
+
+
+        void decode()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            std::vector<double> frames;
+
+            while (!stop_)
+            {
+                // the first chunk in the window, which is not taken
+                std::size_t chunk_index = window_begin_;
+                for (; chunk_index < getWindowEnd(); ++chunk_index)
+                {
+                    if ((0 == decoded_.count(chunk_index))
+                            && (pending_.end() == std::find(pending_.begin(), pending_.end(), chunk_index)))
+                    {
+                        break;
+                    }
+                }
+
+                if (chunk_index == getWindowEnd())
+                {
+                    condition_.wait(lock);
+                    continue;
+                }
+
+                pending_.push_back(chunk_index);
+                lock.unlock();
+
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                try
+                {
+                    trajectory_.decodeChunk(chunk_index, frames);
+                }
+                catch (...)
+                {
+                    lock.lock();
+                    error_ = std::current_exception();
+                    stop_ = true;
+                    condition_.notify_all();
+                    break;
+                }
+                const double decode_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                lock.lock();
+                pending_.erase(std::find(pending_.begin(), pending_.end(), chunk_index));
+                // the window may have moved
+                if ((chunk_index >= window_begin_) && (chunk_index < getWindowEnd()))
+                {
+                    decoded_[chunk_index].swap(frames);
+                }
+                ++chunk_counter_;
+                decoded_frame_counter_ += trajectory_.getChunkFrameNumber(chunk_index);
+                decode_time_ += decode_time;
+                condition_.notify_all();
+            }
+        }
+
+
+        /**
+         * @brief Moves the window of decoded chunks and waits for the given
+         * chunk.
+         */
+        void loadChunk(const std::size_t chunk_index)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+
+            window_begin_ = chunk_index;
+            decoded_.erase(decoded_.begin(), decoded_.lower_bound(window_begin_));
+            decoded_.erase(decoded_.lower_bound(getWindowEnd()), decoded_.end());
+            condition_.notify_all();
+
+            if (0 == decoded_.count(chunk_index))
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                while ((0 == decoded_.count(chunk_index)) && (!stop_))
+                {
+                    condition_.wait(lock);
+                }
+                stall_time_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                ++stall_counter_;
+
+                if (error_)
+                {
+                    std::rethrow_exception(error_);
+                }
+            }
+
+            chunk_.swap(decoded_[chunk_index]);
+            decoded_.erase(chunk_index);
+            chunk_index_ = chunk_index;
+
+            // the next chunk can be decoded
+            window_begin_ = chunk_index + 1;
+            condition_.notify_all();
+
+            FrameProfiler::count(FrameProfiler::BYTES_PARSED, trajectory_.chunks_[chunk_index].size_);
+        }
+
+
+    public:
+        std::size_t     chunk_counter_;
+        std::size_t     decoded_frame_counter_;
+        /// total decoding time of all threads
+        double          decode_time_;
+        std::size_t     stall_counter_;
+        double          stall_time_;
+
+
+    public:
+        /**
+         * @param[in] data_file
+         * @param[in] body_names
+         * @param[in] thread_number number of decoding threads
+         * @param[in] depth         number of chunks decoded ahead
+         */
+        CompressedPoseSource(   const std::string & data_file,
+                                const std::vector<std::string> & body_names,
+                                const std::size_t thread_number,
+                                const std::size_t depth = 2)
+            : trajectory_(data_file)
+        {
+            name_ = data_file;
+            columns_ = trajectory_.getColumns(body_names);
+            frame_index_ = 0;
+            chunk_index_ = trajectory_.header_->getChunkNumber();
+
+            depth_ = std::max(depth, static_cast<std::size_t>(1));
+            window_begin_ = 0;
+            stop_ = false;
+
+            chunk_counter_ = 0;
+            decoded_frame_counter_ = 0;
+            decode_time_ = 0.0;
+            stall_counter_ = 0;
+            stall_time_ = 0.0;
+
+            for (std::size_t i = 0; i < std::max(thread_number, static_cast<std::size_t>(1)); ++i)
+            {
+                threads_.push_back(std::thread(&CompressedPoseSource::decode, this));
+            }
+        }
+
+
+        ~CompressedPoseSource()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+                condition_.notify_all();
+            }
+
+            for (std::size_t i = 0; i < threads_.size(); ++i)
+            {
+                threads_[i].join();
+            }
+        }
+
+
+        std::size_t getChunkSize() const
+        {
+            return (trajectory_.header_->chunk_size_);
+        }
+
+
+        /**
+         * @brief Sets the number of chunks decoded ahead.
+         */
+        void setDepth(const std::size_t depth)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            depth_ = std::max(depth, static_cast<std::size_t>(1));
+            condition_.notify_all();
+        }
+
+
+        bool readFrame(std::vector<double> & poses)
+        {
+            if (frame_index_ >= trajectory_.header_->frame_number_)
+            {
+                eof_ = true;
+                return (false);
+            }
+
+            const std::size_t chunk_index = frame_index_ / trajectory_.header_->chunk_size_;
+            if (chunk_index != chunk_index_)
+            {
+                loadChunk(chunk_index);
+            }
+
+            const double * frame = &chunk_[(frame_index_ % trajectory_.header_->chunk_size_) * trajectory_.header_->getFrameSize()];
+            for (std::size_t i = 0; i < columns_.size(); ++i)
+            {
+                std::copy(frame + columns_[i] * 6, frame + columns_[i] * 6 + 6, poses.begin() + i * 6);
+            }
+
+            ++frame_index_;
+            return (true);
+        }
+
+
+        bool skipFrame(std::vector<double> &)
+        {
+            if (frame_index_ < trajectory_.header_->frame_number_)
+            {
+                ++frame_index_;
+                return (true);
+            }
+            else
+            {
+                eof_ = true;
+                return (false);
+            }
+        }
+
+
+        bool isSeekable() const
+        {
+            return (true);
+        }
+
+
+        /**
+         * @brief Decoding ahead is restarted from the new position on the
+         * next readFrame().
+         */
+        void seek(const std::size_t frame_index)
+        {
+            frame_index_ = frame_index;
+            eof_ = false;
+        }
+
+
+        void printStatistics() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            std::cout << "Compressed `" << name_ << "`: " << chunk_counter_ << " chunks decoded by "
+                      << threads_.size() << " threads";
+            if (decode_time_ > 0.0)
+            {
+                std::cout << " (" << decoded_frame_counter_ / decode_time_ << " frames/s per thread)";
+            }
+            std::cout << ", " << stall_counter_ << " stalls (" << stall_time_ * 1000.0 << " ms)" << std::endl;
+        }
+};
+
+
+
+/**
+ * @brief Live text stream from stdin ('-') or a named pipe.
+ *
+ * The stream is read without blocking: each call to readFrame() drains all
+ * available data and parses only the newest complete line, older lines are
+ * counted as dropped. If no new line is available, the previous frame is
+ * kept. End of stream is reported when the writer closes the stream after
+ * sending data.
+ */
+class StreamPoseSource : public PoseSource
+{
+    protected:
+        std::string         data_file_;
+        int                 descriptor_;
+        bool                connected_;
+        bool                timestamp_column_;
+
+        /// received data, starts with an incomplete line or is empty
+        std::vector<char>   buffer_;
+
+        std::size_t         line_counter_;
+        std::size_t         dropped_counter_;
+        std::size_t         poll_counter_;
+        std::size_t         empty_poll_counter_;
+
+
+    protected:
+        /**
+         * @brief Appends all available data to buffer_. The descriptor is
+         * polled before reading, so that stdin can stay in blocking mode,
+         * which is shared with the parent process.
+         */
+        void drain()
+        {
+            const std::size_t chunk_size = 1 << 16;
+
+            for (;;)
+            {
+                struct pollfd poll_descriptor;
+                poll_descriptor.fd = descriptor_;
+                poll_descriptor.events = POLLIN;
+                poll_descriptor.revents = 0;
+
+                const int poll_result = poll(&poll_descriptor, 1, 0);
+                if ((poll_result < 0) && (EINTR == errno))
+                {
+                    continue;
+                }
+                if (0 == poll_result)
+                {
+                    return;
+                }
+
+                const std::size_t size = buffer_.size();
+                buffer_.resize(size + chunk_size);
+
+                const ssize_t read_size = read(descriptor_, &buffer_[size], chunk_size);
+                buffer_.resize(size + std::max(read_size, static_cast<ssize_t>(0)));
+
+                if (read_size > 0)
+                {
+                    FrameProfiler::count(FrameProfiler::BYTES_PARSED, read_size);
+                    connected_ = true;
+                    continue;
+                }
+
+                if (0 == read_size)
+                {
+                    // a pipe without writers: the writer is gone or not started yet
+                    eof_ = connected_;
+                    return;
+                }
+
+                if (EINTR == errno)
+                {
+                    continue;
+                }
+                if ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+                {
+                    return;
+                }
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot read stream `"
+                        + data_file_ + "`: " + strerror(errno));
+            }
+        }
+
+
+    public:
+        /**
+         * @param[in] data_file '-' for stdin or path to a named pipe
+         * @param[in] timestamp_column  see TextPoseSource
+         */
+        StreamPoseSource(   const std::string & data_file,
+                            const bool timestamp_column = false)
+        {
+            data_file_ = data_file;
+            connected_ = false;
+            timestamp_column_ = timestamp_column;
+
+            line_counter_ = 0;
+            dropped_counter_ = 0;
+            poll_counter_ = 0;
+            empty_poll_counter_ = 0;
+
+            if ("-" == data_file_)
+            {
+                descriptor_ = STDIN_FILENO;
+            }
+            else
+            {
+                // does not wait for a writer
+                descriptor_ = open(data_file_.c_str(), O_RDONLY | O_NONBLOCK);
+            }
+
+            if (descriptor_ < 0)
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot open stream: " + data_file_);
+            }
+        }
+
+
+        ~StreamPoseSource()
+        {
+            if (STDIN_FILENO != descriptor_)
+            {
+                close(descriptor_);
+            }
+        }
+
+
+        /**
+         * @brief True for stdin ('-') and named pipes.
+         */
+        static bool isStream(const std::string & data_file)
+        {
+            struct stat file_stat;
+            return (("-" == data_file)
+                    || ((0 == stat(data_file.c_str(), &file_stat)) && (S_ISFIFO(file_stat.st_mode))));
+        }
+
+
+        bool readFrame(std::vector<double> & poses)
+        {
+            ++poll_counter_;
+            drain();
+
+
+            // find the newest non-empty complete line
+            const char *    newest_line = NULL;
+            std::size_t     consumed_size = 0;
+            std::size_t     line_number = 0;
+
+            for (std::size_t line_start = 0, i = 0; i < buffer_.size(); ++i)
+            {
+                if ('\n' == buffer_[i])
+                {
+                    buffer_[i] = '\0';
+
+                    const char * cursor = &buffer_[line_start];
+                    TextScanner::skipSpaces(cursor);
+                    if ('\0' != *cursor)
+                    {
+                        newest_line = &buffer_[line_start];
+                        ++line_number;
+                    }
+
+                    line_start = i + 1;
+                    consumed_size = line_start;
+                }
+            }
+
+
+            if (NULL == newest_line)
+            {
+                buffer_.erase(buffer_.begin(), buffer_.begin() + consumed_size);
+                ++empty_poll_counter_;
+                return (false);
+            }
+
+            line_counter_ += line_number;
+            dropped_counter_ += line_number - 1;
+
+            TextPoseSource::parseLine(newest_line, poses, line_counter_, data_file_, timestamp_column_, timestamp_);
+
+            buffer_.erase(buffer_.begin(), buffer_.begin() + consumed_size);
+
+            return (true);
+        }
+
+
+        void printStatistics() const
+        {
+            std::cout << "Stream `" << data_file_ << "`: " << line_counter_ << " frames received, "
+                      << dropped_counter_ << " dropped, " << empty_poll_counter_ << " of "
+                      << poll_counter_ << " polls without new frames" << std::endl;
+        }
+};
+
+
+
+/**
+ * @brief Poses published in POSIX shared memory, see shared_memory_poses.h.
+ *
+ * readFrame() never blocks: it returns the latest consistent update or false
+ * if there is no new update (or no writer yet), in which case the previous
+ * frame is kept.
+ */
+class SharedMemoryPoseSource : public PoseSource
+{
+    protected:
+        SharedMemoryPosesReader reader_;
+        std::string             name_;
+
+        std::size_t             frame_counter_;
+        double                  total_latency_;
+        double                  max_latency_;
+
+
+    public:
+        /**
+         * @param[in] name  name of the shared memory object, e.g., '/poses'
+         */
+        SharedMemoryPoseSource(const std::string & name)
+            : reader_(name)
+        {
+            name_ = name;
+
+            frame_counter_ = 0;
+            total_latency_ = 0.0;
+            max_latency_ = 0.0;
+        }
+
+
+        bool readFrame(std::vector<double> & poses)
+        {
+            uint64_t write_time = 0;
+
+            if (!reader_.read(poses, timestamp_, write_time))
+            {
+                return (false);
+            }
+
+            const double latency = (SharedMemoryPosesHeader::getMonotonicTime() - write_time) * 1e-9;
+            total_latency_ += latency;
+            max_latency_ = std::max(max_latency_, latency);
+            ++frame_counter_;
+
+            return (true);
+        }
+
+
+        void printStatistics() const
+        {
+            std::cout << "Shared memory `" << name_ << "`: " << frame_counter_ << " frames read, "
+                      << reader_.skip_counter_ << " updates skipped, " << reader_.retry_counter_ << " retries, "
+                      << reader_.reattach_counter_ << " reattachments";
+            if (frame_counter_ > 0)
+            {
+                std::cout << ", latency: average " << total_latency_ / frame_counter_ * 1e6
+                          << " us, max " << max_latency_ * 1e6 << " us";
+            }
+            std::cout << std::endl;
+        }
+};
+
+
+
+/**
+ * @brief Resamples frames of another source from the data rate to the
+ * display rate.
+ *
+ * Displayed frame k corresponds to the position k * data_rate / display_rate
+ * in the data. Frames between the needed ones are skipped with
+ * PoseSource::skipFrame(), i.e., without parsing. If the position falls
+ * between two frames, positions are interpolated linearly and orientations
+ * with quaternion SLERP; timestamps are interpolated linearly as well.
+ */
+class ResamplingPoseSource : public PoseSource
+{
+    protected:
+        std::string                 name_;
+        osg::ref_ptr<PoseSource>    source_;
+        std::size_t                 frame_size_;
+        /// number of data frames per displayed frame
+        double                      step_;
+
+        /// index of the next displayed frame
+        std::size_t                 display_frame_;
+        /// index of the frame, which is read next from source_
+        std::size_t                 source_frame_;
+
+        /// two last frames read from source_
+        std::vector<double>         frames_[2];
+        double                      timestamps_[2];
+        std::size_t                 frame_indices_[2];
+        bool                        valid_[2];
+
+        // may be read while a PrefetchPoseSource thread uses the source
+        std::atomic<std::size_t>    frame_counter_;
+        std::atomic<std::size_t>    skip_counter_;
+        std::atomic<std::size_t>    interpolation_counter_;
+
+
+    protected:
+        static osg::Quat getAttitude(const double * rpy)
+        {
+            return (osg::Quat(  rpy[0], osg::Vec3d(1., 0., 0.),
+                                rpy[1], osg::Vec3d(0., 1., 0.),
+                                rpy[2], osg::Vec3d(0., 0., 1.)));
+        }
+
+
+        /**
+         * @brief Inverse of getAttitude(), rotation matrix is
+         * Rz(yaw) * Ry(pitch) * Rx(roll).
+         */
+        static void getRPY(const osg::Quat & attitude, double * rpy)
+        {
+            const osg::Vec3d x_axis = attitude * osg::Vec3d(1., 0., 0.);
+            const osg::Vec3d y_axis = attitude * osg::Vec3d(0., 1., 0.);
+            const osg::Vec3d z_axis = attitude * osg::Vec3d(0., 0., 1.);
+
+            rpy[0] = atan2(y_axis.z(), z_axis.z());
+            rpy[1] = asin(std::max(-1.0, std::min(1.0, -x_axis.z())));
+            rpy[2] = atan2(x_axis.y(), x_axis.x());
+        }
+
+
+        /**
+         * @brief Returns the slot of frames_, which contains the given
+         * frame, or -1 if the source ended.
+         *
+         * @param[in] frame_index
+         * @param[in] keep_slot     slot, which must not be overwritten, -1
+         *                          if any
+         */
+        int getFrame(const std::size_t frame_index, const int keep_slot)
+        {
+            for (int i = 0; i < 2; ++i)
+            {
+                if (valid_[i] && (frame_indices_[i] == frame_index))
+                {
+                    return (i);
+                }
+            }
+
+            int slot = 0;
+            if (keep_slot >= 0)
+            {
+                slot = 1 - keep_slot;
+            }
+            else if (valid_[0] && ((!valid_[1]) || (frame_indices_[1] < frame_indices_[0])))
+            {
+                slot = 1;
+            }
+            valid_[slot] = false;
+
+            if (frame_index < source_frame_)
+            {
+                source_->seek(frame_index);
+                source_frame_ = frame_index;
+            }
+
+            for (; source_frame_ < frame_index; ++source_frame_)
+            {
+                if (!source_->skipFrame(frames_[slot]))
+                {
+                    return (-1);
+                }
+                ++skip_counter_;
+            }
+
+            if (!source_->readFrame(frames_[slot]))
+            {
+                return (-1);
+            }
+            ++source_frame_;
+
+            timestamps_[slot] = source_->timestamp_;
+            frame_indices_[slot] = frame_index;
+            valid_[slot] = true;
+
+            return (slot);
+        }
+
+
+    public:
+        /**
+         * @param[in] name          used in statistics
+         * @param[in] source        source of frames at the data rate
+         * @param[in] frame_size    number of values in a frame
+         * @param[in] data_rate     frames per second in the data
+         * @param[in] display_rate  displayed frames per second
+         */
+        ResamplingPoseSource(   const std::string & name,
+                                osg::ref_ptr<PoseSource> source,
+                                const std::size_t frame_size,
+                                const double data_rate,
+                                const double display_rate)
+            : frame_counter_(0), skip_counter_(0), interpolation_counter_(0)
+        {
+            if ((data_rate <= 0.0) || (display_rate <= 0.0))
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Data and display rates must be positive.");
+            }
+
+            name_ = name;
+            source_ = source;
+            frame_size_ = frame_size;
+            step_ = data_rate / display_rate;
+
+            display_frame_ = 0;
+            source_frame_ = 0;
+            for (std::size_t i = 0; i < 2; ++i)
+            {
+                frames_[i].resize(frame_size_);
+                timestamps_[i] = 0.0;
+                frame_indices_[i] = 0;
+                valid_[i] = false;
+            }
+        }
+
+
+        bool readFrame(std::vector<double> & poses)
+        {
+            // position in the data, rounding errors are ignored
+            const double position = display_frame_ * step_;
+            std::size_t frame_index = static_cast<std::size_t>(floor(position));
+            double alpha = position - frame_index;
+            if (alpha > 1.0 - 1e-6)
+            {
+                ++frame_index;
+                alpha = 0.0;
+            }
+
+            const int lower = getFrame(frame_index, -1);
+            if (lower < 0)
+            {
+                eof_ = source_->eof();
+                return (false);
+            }
+
+            // the last frame is repeated at the end of the data
+            const int upper = (alpha < 1e-6) ? -1 : getFrame(frame_index + 1, lower);
+
+            if (upper < 0)
+            {
+                std::copy(frames_[lower].begin(), frames_[lower].end(), poses.begin());
+                timestamp_ = timestamps_[lower];
+            }
+            else
+            {
+                const double * from = frames_[lower].data();
+                const double * to = frames_[upper].data();
+
+                for (std::size_t i = 0; i < frame_size_; i += 6)
+                {
+                    for (std::size_t j = i; j < i + 3; ++j)
+                    {
+                        poses[j] = from[j] + alpha * (to[j] - from[j]);
+                    }
+
+                    osg::Quat attitude;
+                    attitude.slerp(alpha, getAttitude(from + i + 3), getAttitude(to + i + 3));
+                    getRPY(attitude, &poses[i + 3]);
+                }
+                timestamp_ = timestamps_[lower] + alpha * (timestamps_[upper] - timestamps_[lower]);
+
+                ++interpolation_counter_;
+            }
+
+            ++display_frame_;
+            ++frame_counter_;
+            return (true);
+        }
+
+
+        bool isSeekable() const
+        {
+            return (source_->isSeekable());
+        }
+
+
+        /**
+         * @param[in] frame_index   index of a displayed frame
+         */
+        void seek(const std::size_t frame_index)
+        {
+            display_frame_ = frame_index;
+            source_frame_ = static_cast<std::size_t>(floor(frame_index * step_));
+            source_->seek(source_frame_);
+
+            valid_[0] = false;
+            valid_[1] = false;
+            eof_ = false;
+        }
+
+
+        void printStatistics() const
+        {
+            std::cout << "Resampling of `" << name_ << "`: " << frame_counter_ << " frames displayed, "
+                      << interpolation_counter_ << " interpolated, " << skip_counter_ << " data frames skipped"
+                      << std::endl;
+        }
+};
+
+
+
+/**
+ * @brief Reads frames of another source ahead of time in a background
+ * thread.
+ *
+ * Decoded frames are passed through a bounded single-producer /
+ * single-consumer ring, so that the rendering thread only copies ready
+ * frames. When the ring is empty, the consumer waits for the producer,
+ * such stalls are counted.
+ *
+ * The ring also keeps up to depth frames behind the consumer, seeks to
+ * these frames and to prefetched frames are served from the ring. Other
+ * seeks stop the producer: backward seeks, e.g., during reverse playback,
+ * read frames directly from the source without prefetching, the producer
+ * is restarted when frames are read sequentially again or on a forward
+ * seek. Thus, reverse playback costs a seek of the source per frame, as
+ * without prefetching.
+ */
+class PrefetchPoseSource : public PoseSource
+{
+    protected:
+        std::string                 name_;
+        osg::ref_ptr<PoseSource>    source_;
+        std::size_t                 frame_size_;
+        /// number of frames read ahead
+        std::size_t                 depth_;
+        /// number of slots in the ring: depth_ ahead and depth_ behind
+        std::size_t                 slot_number_;
+
+        /// slot_number_ frames of frame_size_ values followed by a timestamp
+        std::vector<double>         ring_;
+
+        /// total number of frames written by the producer
+        std::atomic<std::size_t>    head_;
+        /// total number of frames taken by the consumer
+        std::atomic<std::size_t>    tail_;
+
+        std::atomic<bool>           finished_;
+        std::atomic<bool>           stop_;
+        std::exception_ptr          error_;
+
+        std::thread                 thread_;
+
+        /// index of the frame in the first slot written by the producer
+        std::size_t                 first_frame_;
+        /// the largest tail since the start of the producer, the producer
+        /// never overwrites depth_ frames preceding it
+        std::size_t                 max_tail_;
+
+        /// the producer is stopped, frames are read from the source
+        bool                        bypass_;
+        /// index of the next frame of the source while bypassing the ring
+        std::size_t                 next_frame_;
+        /// the last call was seek()
+        bool                        seeked_;
+
+
+    protected:
+        static void backoff()
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+
+
+        void produce()
+        {
+            try
+            {
+                std::vector<double> frame(frame_size_);
+
+                while (!stop_.load(std::memory_order_relaxed))
+                {
+                    const std::size_t head = head_.load(std::memory_order_relaxed);
+
+                    // the tail may move back on seek()
+                    if (head - tail_.load(std::memory_order_acquire) >= depth_)
+                    {
+                        backoff();
+                        continue;
+                    }
+
+                    if (!source_->readFrame(frame))
+                    {
+                        break;
+                    }
+
+                    std::vector<double>::iterator slot = ring_.begin() + (head % slot_number_) * (frame_size_ + 1);
+                    std::copy(frame.begin(), frame.end(), slot);
+                    slot[frame_size_] = source_->timestamp_;
+
+                    head_.store(head + 1, std::memory_order_release);
+                }
+            }
+            catch (...)
+            {
+                error_ = std::current_exception();
+            }
+
+            finished_.store(true, std::memory_order_release);
+        }
+
+
+        /**
+         * @brief Starts the producer, the source must be positioned at the
+         * given frame.
+         */
+        void startProducer(const std::size_t first_frame)
+        {
+            head_.store(0);
+            tail_.store(0);
+            finished_.store(false);
+            stop_.store(false);
+            error_ = std::exception_ptr();
+
+            first_frame_ = first_frame;
+            max_tail_ = 0;
+            bypass_ = false;
+
+            thread_ = std::thread(&PrefetchPoseSource::produce, this);
+        }
+
+
+        void stopProducer()
+        {
+            if (thread_.joinable())
+            {
+                stop_.store(true, std::memory_order_relaxed);
+                thread_.join();
+            }
+        }
+
+
+        /**
+         * @brief True if the frame is prefetched or is still kept behind the
+         * tail of the ring, see max_tail_.
+         */
+        bool isInRing(const std::size_t frame_index) const
+        {
+            if (bypass_ || (frame_index < first_frame_))
+            {
+                return (false);
+            }
+
+            const std::size_t position = frame_index - first_frame_;
+            return ((position + depth_ >= max_tail_) && (position <= head_.load(std::memory_order_acquire)));
+        }
+
+
+    public:
+        std::size_t     frame_counter_;
+        std::size_t     stall_counter_;
+        double          stall_time_;
+        /// number of seeks served from the ring
+        std::size_t     ring_seek_counter_;
+        /// number of frames read without prefetching
+        std::size_t     bypass_counter_;
+
+
+    public:
+        /**
+         * @param[in] name          used in statistics
+         * @param[in] source        source of frames at the first frame,
+         *                          accessed only by the background thread
+         *                          afterwards, unless the ring is bypassed
+         * @param[in] frame_size    number of values in a frame
+         * @param[in] depth         number of frames read ahead
+         */
+        PrefetchPoseSource( const std::string & name,
+                            osg::ref_ptr<PoseSource> source,
+                            const std::size_t frame_size,
+                            const std::size_t depth)
+            : head_(0), tail_(0), finished_(false), stop_(false)
+        {
+            name_ = name;
+            source_ = source;
+            frame_size_ = frame_size;
+            depth_ = std::max(depth, static_cast<std::size_t>(1));
+            slot_number_ = 2 * depth_;
+            ring_.resize(slot_number_ * (frame_size_ + 1));
+
+            next_frame_ = 0;
+            seeked_ = false;
+
+            frame_counter_ = 0;
+            stall_counter_ = 0;
+            stall_time_ = 0.0;
+            ring_seek_counter_ = 0;
+            bypass_counter_ = 0;
+
+            startProducer(0);
+        }
+
+
+        ~PrefetchPoseSource()
+        {
+            stopProducer();
+        }
+
+
+        bool isSeekable() const
+        {
+            return (source_->isSeekable());
+        }
+
+
+        /**
+         * @brief Moves the tail of the ring if the frame is in the ring,
+         * otherwise stops the producer and seeks the source, see the class
+         * description.
+         */
+        void seek(const std::size_t frame_index)
+        {
+            seeked_ = true;
+            eof_ = false;
+
+            if (isInRing(frame_index))
+            {
+                const std::size_t position = frame_index - first_frame_;
+
+                tail_.store(position, std::memory_order_release);
+                max_tail_ = std::max(max_tail_, position);
+                ++ring_seek_counter_;
+                return;
+            }
+
+            const std::size_t current_frame = bypass_ ? next_frame_ : first_frame_ + tail_.load(std::memory_order_relaxed);
+
+            stopProducer();
+            source_->seek(frame_index);
+
+            if (frame_index < current_frame)
+            {
+                bypass_ = true;
+                next_frame_ = frame_index;
+            }
+            else
+            {
+                startProducer(frame_index);
+            }
+        }
+
+
+        bool readFrame(std::vector<double> & poses)
+        {
+            if (bypass_)
+            {
+                if (seeked_)
+                {
+                    seeked_ = false;
+                    ++bypass_counter_;
+
+                    if (!source_->readFrame(poses))
+                    {
+                        eof_ = source_->eof();
+                        return (false);
+                    }
+                    timestamp_ = source_->timestamp_;
+                    ++next_frame_;
+                    ++frame_counter_;
+                    return (true);
+                }
+
+                // frames are read sequentially again
+                startProducer(next_frame_);
+            }
+            seeked_ = false;
+
+
+            const std::size_t tail = tail_.load(std::memory_order_relaxed);
+
+            if (head_.load(std::memory_order_acquire) == tail)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                bool ready = false;
+
+                while (!ready)
+                {
+                    // finished_ is set after the last frame is published
+                    const bool finished = finished_.load(std::memory_order_acquire);
+
+                    ready = (head_.load(std::memory_order_acquire) != tail);
+                    if ((!ready) && finished)
+                    {
+                        stall_time_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                        if (error_)
+                        {
+                            std::rethrow_exception(error_);
+                        }
+                        eof_ = source_->eof();
+                        return (false);
+                    }
+
+                    if (!ready)
+                    {
+                        backoff();
+                    }
+                }
+                stall_time_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                ++stall_counter_;
+            }
+
+            std::vector<double>::const_iterator frame = ring_.begin() + (tail % slot_number_) * (frame_size_ + 1);
+            std::copy(frame, frame + frame_size_, poses.begin());
+            timestamp_ = frame[frame_size_];
+            tail_.store(tail + 1, std::memory_order_release);
+            max_tail_ = std::max(max_tail_, tail + 1);
+
+            ++frame_counter_;
+            return (true);
+        }
+
+
+        void printStatistics() const
+        {
+            source_->printStatistics();
+            std::cout << "Prefetch of `" << name_ << "`: " << frame_counter_ << " frames, "
+                      << stall_counter_ << " stalls (" << stall_time_ * 1000.0 << " ms), "
+                      << ring_seek_counter_ << " seeks in the ring, "
+                      << bypass_counter_ << " frames read without prefetching" << std::endl;
+        }
+};
+
+
+
+/**
+ * @brief Wraps a source with PrefetchPoseSource if prefetch_depth > 0.
+ */
+osg::ref_ptr<PoseSource> prefetchPoseSource(const std::string & name,
+                                            osg::ref_ptr<PoseSource> source,
+                                            const std::size_t frame_size,
+                                            const std::size_t prefetch_depth)
+{
+    if (prefetch_depth > 0)
+    {
+        return (new PrefetchPoseSource(name, source, frame_size, prefetch_depth));
+    }
+    else
+    {
+        return (source);
+    }
+}
+
+
+
+/**
+ * @brief Selects a pose source depending on the format of the data file,
+ * '-' stands for stdin, 'shm:<name>' for a shared memory object.
+ *
+ * Frames of files are resampled if both rates are given and differ, live
+ * sources provide the latest frame and are never resampled.
+ */
+osg::ref_ptr<PoseSource> createPoseSource(  const std::string & data_file,
+                                            const std::vector<std::string> & body_names,
+                                            const std::size_t prefetch_depth = 0,
+                                            const bool timestamp_column = false,
+                                            const double data_rate = 0.0,
+                                            const double display_rate = 0.0)
+{
+    osg::ref_ptr<PoseSource> source;
+
+    if (0 == data_file.compare(0, 4, "shm:"))
+    {
+        return (new SharedMemoryPoseSource(data_file.substr(4)));
+    }
+
+    if (StreamPoseSource::isStream(data_file))
+    {
+        // prefetching would delay the newest frames
+        return (new StreamPoseSource(data_file, timestamp_column));
+    }
+
+    if (isCompressedTrajectoryFile(data_file))
+    {
+        if (timestamp_column)
+        {
+            throw std::runtime_error(std::string("In ") + __func__ + "() // Timestamps are supported only in text data files: " + data_file);
+        }
+        // prefetch depth is given in frames, the number of frames in a chunk
+        // is stored in the file
+        const std::size_t thread_number = std::min(std::max(std::thread::hardware_concurrency() / 2, 1U), COMPRESSED_POSE_SOURCE_MAX_THREADS);
+        osg::ref_ptr<CompressedPoseSource> compressed_source = new CompressedPoseSource(data_file, body_names, thread_number);
+        compressed_source->setDepth(std::max(prefetch_depth / compressed_source->getChunkSize(), 2 * static_cast<std::size_t>(thread_number)));
+        source = compressed_source.get();
+    }
+    else if (isBinaryTrajectoryFile(data_file))
+    {
+        if (timestamp_column)
+        {
+            throw std::runtime_error(std::string("In ") + __func__ + "() // Timestamps are supported only in text data files: " + data_file);
+        }
+        source = new BinaryPoseSource(data_file, body_names);
+    }
+    else
+    {
+        source = new TextPoseSource(data_file, timestamp_column);
+    }
+
+    if ((data_rate > 0.0) && (display_rate > 0.0) && (data_rate != display_rate))
+    {
+        // resampling is done by the prefetching thread, if any
+        source = new ResamplingPoseSource(data_file, source, body_names.size() * 6, data_rate, display_rate);
+    }
+
+    return (prefetchPoseSource(data_file, source, body_names.size() * 6, prefetch_depth));
+}
@@ -10,48 +10,59 @@
 #pragma once
 
 
+/**
+ * @brief Poses of the bodies of one or several robots stored by body index.
+ */
 class robotDataType : public osg::Referenced
 {
     public:
-        robotDataType(osg::ref_ptr<osg::Group> robot_group)
+        robotDataType()
         {
-            robot_group_ = robot_group;
+            updated_ = false;
+        }
+
+        /**
+         * @brief Registers a body transform, its index is the index of the
+         * body in the pose buffer.
+         */
+        std::size_t addBody(osg::ref_ptr<osg::PositionAttitudeTransform> body_transform)
+        {
+            body_transforms_.push_back(body_transform);
+            positions_.push_back(osg::Vec3(0., 0., 0.));
+            attitudes_.push_back(osg::Quat());
+
+            return (body_transforms_.size() - 1);
         }
 
-        void setBodyState(  const std::string name,
+        void setBodyState(  const std::size_t index,
                             const osg::Vec3 & position,
                             const osg::Vec3 & rpy)
         {
-            body_states_[name] = new osg::PositionAttitudeTransform;
-            body_states_[name]->setPosition(position);
-            body_states_[name]->setAttitude(convertRPYtoQuaternion(rpy));
+            positions_[index] = position;
+            attitudes_[index] = convertRPYtoQuaternion(rpy);
+            updated_ = true;
         }
 
         void updateRobotState()
         {
-            for (std::size_t i = 0; i < robot_group_->getNumChildren(); ++i)
+            if (updated_)
             {
-                osg::ref_ptr<osg::PositionAttitudeTransform>  body_state =
-                        dynamic_cast<osg::PositionAttitudeTransform *> (robot_group_->getChild(i));
-
-                if (NULL != body_state)
+                for (std::size_t i = 0; i < body_transforms_.size(); ++i)
                 {
-                    std::map<std::string, osg::ref_ptr<osg::PositionAttitudeTransform> >::iterator it;
-
-                    it = body_states_.find(body_state->getName());
-                    if (it != body_states_.end())
-                    {
-                        body_state->setPosition(it->second->getPosition());
-                        body_state->setAttitude(it->second->getAttitude());
-                    }
+                    body_transforms_[i]->setPosition(positions_[i]);
+                    body_transforms_[i]->setAttitude(attitudes_[i]);
                 }
+                updated_ = false;
             }
         }
 
     public:
-        std::map<std::string, osg::ref_ptr<osg::PositionAttitudeTransform> >    body_states_;
+        std::vector<osg::Vec3>  positions_;
+        std::vector<osg::Quat>  attitudes_;
 
-        osg::ref_ptr<osg::Group> robot_group_;
+        std::vector< osg::ref_ptr<osg::PositionAttitudeTransform> > body_transforms_;
+
+        bool    updated_;
 };
 
 
@@ -59,17 +70,22 @@ class robotDataType : public osg::Referenced
 class robotNodeCallback : public osg::NodeCallback
 {
     public:
+        robotNodeCallback(osg::ref_ptr<robotDataType> robot_data)
+        {
+            robot_data_ = robot_data;
+        }
+
         virtual void operator()(osg::Node* node, osg::NodeVisitor* nv)
         {
-            osg::ref_ptr<robotDataType> robot_data = dynamic_cast<robotDataType*> (node->getUserData() );
+            FrameProfiler::ScopedTimer timer(FrameProfiler::UPDATE);
 
-            if(robot_data)
-            {
-                robot_data->updateRobotState();
-            }
+            robot_data_->updateRobotState();
 
             traverse(node, nv);
         }
+
+    protected:
+        osg::ref_ptr<robotDataType> robot_data_;
 };
 
 
@@ -77,21 +93,16 @@ class robotNodeCallback : public osg::NodeCallback
 class Robot : public osg::Referenced
 {
     protected:
-        void readState( std::stringstream &stream,
-                        const std::string &id) const
+        static osg::ref_ptr<osgDB::Options> getMeshOptions(const bool ignore_rotation_in_file)
         {
-            osg::Vec3  position;
-            osg::Vec3  rotation;
-
-            stream >> position.x();
-            stream >> position.y();
-            stream >> position.z();
+            osg::ref_ptr<osgDB::Options> options = new osgDB::Options;
 
-            stream >> rotation.x();
-            stream >> rotation.y();
-            stream >> rotation.z();
+            if (ignore_rotation_in_file)
+            {
+                options->setOptionString("noRotation");
+            }
 
-            robot_data_->setBodyState(id, position, rotation);
+            return (options);
         }
 
 
@@ -102,15 +113,13 @@ class Robot : public osg::Referenced
         {
             bool load_successful = false;
 
-            osg::ref_ptr<osgDB::Options> options = new osgDB::Options;
+            osg::ref_ptr<osg::Node> rb_node = mesh_cache_->get(path, getMeshOptions(ignore_rotation_in_file));
 
-            if (ignore_rotation_in_file)
+            if (rb_node.valid() && (lod_nodes_.find(rb_node.get()) != lod_nodes_.end()))
             {
-                options->setOptionString("noRotation");
+                rb_node = lod_nodes_[rb_node.get()];
             }
 
-            osg::ref_ptr<osg::Node> rb_node = osgDB::readNodeFile(path, options.get());
-
             if (rb_node != NULL)
             {
                 osg::ref_ptr<osg::PositionAttitudeTransform> rb_transform = new osg::PositionAttitudeTransform();
@@ -127,8 +136,10 @@ class Robot : public osg::Referenced
                     rb_transform->addChild(rb_const_transform_copy.get());
                 }
                 rb_transform->setName(name);
+                rb_transform->setDataVariance(osg::Object::DYNAMIC);
 
                 robot_group_->addChild(rb_transform.get());
+                robot_data_->addBody(rb_transform);
 
                 load_successful = true;
 
@@ -138,35 +149,73 @@ class Robot : public osg::Referenced
         }
 
 
-    public:
-        osg::ref_ptr<osg::Group>    robot_group_;
-        osg::ref_ptr<robotDataType> robot_data_;
-        std::ifstream               file_stream_;
-        std::vector<std::string>    body_names_;
+        /**
+         * @brief Decimates each unique mesh once, meshes are processed in
+         * parallel.
+         */
+        void createLevelsOfDetail(  const std::vector<std::string> & mesh_files,
+                                    osg::ref_ptr<osgDB::Options> options,
+                                    const LevelOfDetail & level_of_detail)
+        {
+            std::vector< osg::ref_ptr<osg::Node> > meshes;
+            for (std::size_t i = 0; i < mesh_files.size(); ++i)
+            {
+                osg::ref_ptr<osg::Node> mesh = mesh_cache_->get(mesh_files[i], options);
+
+                if (mesh.valid() && (lod_nodes_.find(mesh.get()) == lod_nodes_.end()))
+                {
+                    lod_nodes_[mesh.get()] = NULL;
+                    meshes.push_back(mesh);
+                }
+            }
 
+            std::vector< osg::ref_ptr<osg::Node> > lods(meshes.size());
+            mesh_cache_->parallelFor(meshes.size(),
+                                     [&](const std::size_t i)
+                                     {
+                                         lods[i] = level_of_detail.create(meshes[i]);
+                                     });
 
-    public:
-        void readStates()
+            for (std::size_t i = 0; i < meshes.size(); ++i)
+            {
+                lod_nodes_[meshes[i].get()] = lods[i];
+            }
+        }
+
+
+        /**
+         * @brief Registers bodies of a robot scene: each body is a named
+         * child transform of the scene. Bodies of a scene loaded by another
+         * robot are shallow copies, which share meshes with the original.
+         */
+        void addRigidBodies(osg::ref_ptr<osg::Group> robot_scene)
         {
-            std::string       line;
+            const bool copy = (robot_scene != robot_group_);
 
-            if (getline(file_stream_, line))
+            for (unsigned int i = 0; i < robot_scene->getNumChildren(); ++i)
             {
-                std::stringstream stream;
-
-                stream.str(line);
-                stream.clear();
+                osg::ref_ptr<osg::PositionAttitudeTransform> rb_transform =
+                    dynamic_cast<osg::PositionAttitudeTransform *>(robot_scene->getChild(i));
 
-                for (std::size_t i = 0; i < body_names_.size(); ++i)
+                if (rb_transform.valid())
                 {
-                    readState(stream, body_names_[i]);
+                    if (copy)
+                    {
+                        rb_transform = new osg::PositionAttitudeTransform(*rb_transform, osg::CopyOp::SHALLOW_COPY);
+                        robot_group_->addChild(rb_transform.get());
+                    }
+                    robot_data_->addBody(rb_transform);
+                    body_names_.push_back(rb_transform->getName());
                 }
             }
         }
 
 
-        void load(const std::string & robot_description_file,
-                  const std::string & data_file)
+        /**
+         * @brief Builds robot_group_ from a robot description or loads it
+         * from the scene cache.
+         */
+        void loadScene(const std::string & robot_description_file)
         {
             std::ifstream file_check(robot_description_file);
             if (file_check.fail())
@@ -191,6 +240,12 @@ class Robot : public osg::Referenced
                 scale = config["scale"].as<double>();
             }
 
+            LevelOfDetail   level_of_detail;
+            if (config["level_of_detail"])
+            {
+                level_of_detail.read(config["level_of_detail"]);
+            }
+
             if (config["path_to_meshes"])
             {
                 path_to_meshes = config["path_to_meshes"].as<std::string>();
@@ -204,11 +259,7 @@ class Robot : public osg::Referenced
             }
 
 
-            robot_group_ = new osg::Group();
-            body_names_.clear();
-
-            osg::ref_ptr<osg::PositionAttitudeTransform> rb_const_transform = new osg::PositionAttitudeTransform();
-            rb_const_transform->setScale(osg::Vec3(scale, scale, scale));
+            robot_group_ = NULL;
 
 
             if (!config["bodies"])
@@ -218,19 +269,211 @@ class Robot : public osg::Referenced
 
             YAML::Node bodies = config["bodies"];
 
+            std::vector<std::string> mesh_files;
             for (std::size_t i = 0; i < bodies.size(); ++i)
             {
-                loadRigidBody(  path_to_meshes + bodies[i]["mesh_file"].as<std::string>(),
-                                bodies[i]["name"].as<std::string>(),
-                                rb_const_transform,
-                                ignore_body_rotation);
+                mesh_files.push_back(path_to_meshes + bodies[i]["mesh_file"].as<std::string>());
             }
 
-            robot_data_ = new robotDataType(robot_group_.get());
 
-            robot_group_->setUserData(robot_data_);
-            robot_group_->setUpdateCallback(new robotNodeCallback);
+            const std::string scene_cache_file = SceneCache::getCacheFile(robot_description_file);
+            const std::string scene_cache_key = SceneCache::getKey(robot_description_file, mesh_files);
+
+            if (SceneCache::USE == scene_cache_mode_)
+            {
+                robot_group_ = SceneCache::read(scene_cache_file, scene_cache_key);
+            }
+
+            if (robot_group_.valid())
+            {
+                addRigidBodies(robot_group_);
+            }
+            else
+            {
+                robot_group_ = new osg::Group();
+
+                osg::ref_ptr<osg::PositionAttitudeTransform> rb_const_transform = new osg::PositionAttitudeTransform();
+                rb_const_transform->setScale(osg::Vec3(scale, scale, scale));
+
+                // parse unique meshes in parallel
+                mesh_cache_->load(mesh_files, getMeshOptions(ignore_body_rotation));
+
+                if (level_of_detail.isEnabled())
+                {
+                    createLevelsOfDetail(mesh_files, getMeshOptions(ignore_body_rotation), level_of_detail);
+                }
+
+                for (std::size_t i = 0; i < bodies.size(); ++i)
+                {
+                    loadRigidBody(  mesh_files[i],
+                                    bodies[i]["name"].as<std::string>(),
+                                    rb_const_transform,
+                                    ignore_body_rotation);
+                }
+
+                // body transforms are dynamic and are preserved; meshes are
+                // shared through the cache with other robot descriptions, so
+                // geometry must not be modified: the scale is kept in the
+                // constant transform instead of being flattened
+                osgUtil::Optimizer optimizer;
+                optimizer.optimize(robot_group_.get(),
+                                   osgUtil::Optimizer::REMOVE_REDUNDANT_NODES
+                                   | osgUtil::Optimizer::SHARE_DUPLICATE_STATE
+                                   | osgUtil::Optimizer::CHECK_GEOMETRY
+                                   | osgUtil::Optimizer::STATIC_OBJECT_DETECTION);
+
+                if (SceneCache::BYPASS != scene_cache_mode_)
+                {
+                    SceneCache::write(robot_group_, scene_cache_file, scene_cache_key);
+                }
+            }
+        }
+
+
+    public:
+        osg::ref_ptr<osg::Group>    robot_group_;
+        osg::ref_ptr<robotDataType> robot_data_;
+        osg::ref_ptr<PoseSource>    pose_source_;
+        std::vector<std::string>    body_names_;
+        std::vector<double>         poses_;
+        osg::ref_ptr<MeshCache>     mesh_cache_;
+        SceneCache::Mode            scene_cache_mode_;
+        /// index of the first body of the robot in robot_data_
+        std::size_t                 first_body_index_;
+        /// robot_data_ is updated by a callback owned by the caller
+        bool                        shared_robot_data_;
+        /// mesh -> LOD node with decimated copies of the mesh
+        std::map<osg::Node *, osg::ref_ptr<osg::Node> >  lod_nodes_;
+
+
+    public:
+        /**
+         * @param[in] mesh_cache    cache shared with other robots, a private
+         *                          cache is created if NULL
+         * @param[in] scene_cache_mode
+         * @param[in] robot_data    poses of bodies of all robots, which must
+         *                          be updated by a robotNodeCallback installed
+         *                          by the caller, e.g., on a common parent of
+         *                          robots; private poses with an own callback
+         *                          are used if NULL
+         */
+        Robot(  osg::ref_ptr<MeshCache> mesh_cache = NULL,
+                const SceneCache::Mode scene_cache_mode = SceneCache::USE,
+                osg::ref_ptr<robotDataType> robot_data = NULL)
+        {
+            mesh_cache_ = mesh_cache.valid() ? mesh_cache : osg::ref_ptr<MeshCache>(new MeshCache);
+            scene_cache_mode_ = scene_cache_mode;
+
+            shared_robot_data_ = robot_data.valid();
+            robot_data_ = shared_robot_data_ ? robot_data : osg::ref_ptr<robotDataType>(new robotDataType);
+            first_body_index_ = 0;
+        }
+
+
+        void readStates()
+        {
+            FrameProfiler::ScopedTimer timer(FrameProfiler::READ);
+
+            if (pose_source_->readFrame(poses_))
+            {
+                for (std::size_t i = 0; i < body_names_.size(); ++i)
+                {
+                    robot_data_->setBodyState(  first_body_index_ + i,
+                                                osg::Vec3(poses_[i*6], poses_[i*6 + 1], poses_[i*6 + 2]),
+                                                osg::Vec3(poses_[i*6 + 3], poses_[i*6 + 4], poses_[i*6 + 5]));
+                }
+            }
+        }
+
+
+        /**
+         * @brief Consumes a frame without updating the bodies, see
+         * PoseSource::skipFrame().
+         */
+        void skipStates()
+        {
+            FrameProfiler::ScopedTimer timer(FrameProfiler::READ);
+            pose_source_->skipFrame(poses_);
+        }
+
+
+        bool eof() const
+        {
+            return (pose_source_->eof());
+        }
+
+
+        bool isSeekable() const
+        {
+            return (pose_source_->isSeekable());
+        }
+
+
+        /**
+         * @brief The next call to readStates() reads the given frame.
+         */
+        void seek(const std::size_t frame_index)
+        {
+            pose_source_->seek(frame_index);
+        }
+
+
+        /**
+         * @brief Timestamp of the current frame, see
+         * RobotDescription::timestamp_column_.
+         */
+        double getTimestamp() const
+        {
+            return (pose_source_->timestamp_);
+        }
+
+
+        void printStatistics() const
+        {
+            pose_source_->printStatistics();
+        }
+
+
+        /**
+         * @param[in] data_rate     frames per second in the data file
+         * @param[in] display_rate  displayed frames per second, see
+         *                          ResamplingPoseSource
+         */
+        void load(const std::string & robot_description_file,
+                  const std::string & data_file,
+                  const std::size_t prefetch_depth = 0,
+                  const bool timestamp_column = false,
+                  const double data_rate = 0.0,
+                  const double display_rate = 0.0)
+        {
+            body_names_.clear();
+            first_body_index_ = robot_data_->body_transforms_.size();
+
+            // each description is loaded once, robots share meshes
+            osg::ref_ptr<osg::Group> robot_scene = mesh_cache_->getRobotScene(robot_description_file);
+            if (robot_scene.valid())
+            {
+                robot_group_ = new osg::Group();
+                addRigidBodies(robot_scene);
+                // meshes are shared
+                FrameProfiler::count(FrameProfiler::NODES_ALLOCATED, 1 + robot_group_->getNumChildren());
+            }
+            else
+            {
+                loadScene(robot_description_file);
+                mesh_cache_->addRobotScene(robot_description_file, robot_group_);
+                if (FrameProfiler::isEnabled())
+                {
+                    FrameProfiler::count(FrameProfiler::NODES_ALLOCATED, countNodes(robot_group_));
+                }
+            }
+
+            if (!shared_robot_data_)
+            {
+                robot_group_->setUpdateCallback(new robotNodeCallback(robot_data_));
+            }
 
-            file_stream_.open(data_file);
+            poses_.resize(body_names_.size() * 6);
+            pose_source_ = createPoseSource(data_file, body_names_, prefetch_depth, timestamp_column, data_rate, display_rate);
         }
 };
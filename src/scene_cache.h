@@ -0,0 +1,185 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Cache of assembled robot scenes in native OSG binary format.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+
+#define SCENE_CACHE_VERSION "orv-scene-cache-1"
+
+
+/**
+ * @brief Stores the scene of a robot (bodies with scaled and optimized
+ * meshes) in '<robot description file>.osgb'.
+ *
+ * The cache is valid while the key stored in the description of the root
+ * node matches the key computed from the content of the description file
+ * and the path, size and modification time of the mesh files.
+ */
+class SceneCache
+{
+    public:
+        enum Mode
+        {
+            /// load the scene from the cache if it is valid, update it otherwise
+            USE = 0,
+            /// ignore the cache
+            BYPASS = 1,
+            /// ignore the existing cache, save a new one
+            REBUILD = 2
+        };
+
+
+    protected:
+        static void hash(uint64_t & state, const void * data, const std::size_t size)
+        {
+            const unsigned char * bytes = static_cast<const unsigned char *>(data);
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                state = (state ^ bytes[i]) * 1099511628211ULL;
+            }
+        }
+
+
+        static void hash(uint64_t & state, const std::string & string)
+        {
+            // the terminating null separates strings
+            hash(state, string.c_str(), string.size() + 1);
+        }
+
+
+    public:
+        static std::string getCacheFile(const std::string & robot_description_file)
+        {
+            return (robot_description_file + ".osgb");
+        }
+
+
+        static Mode parseMode(const std::string & mode)
+        {
+            if ("use" == mode)
+            {
+                return (USE);
+            }
+            if ("off" == mode)
+            {
+                return (BYPASS);
+            }
+            if ("rebuild" == mode)
+            {
+                return (REBUILD);
+            }
+            throw std::runtime_error(std::string("In ") + __func__ + "() // Unknown scene cache mode: " + mode);
+        }
+
+
+        /**
+         * @brief Computes the key of a scene, meshes are identified by
+         * metadata only in order to avoid reading them.
+         */
+        static std::string getKey( const std::string & robot_description_file,
+                                   const std::vector<std::string> & mesh_files)
+        {
+            uint64_t state = 14695981039346656037ULL;
+
+            hash(state, SCENE_CACHE_VERSION);
+
+            FILE * file = fopen(robot_description_file.c_str(), "rb");
+            if (NULL != file)
+            {
+                char buffer[1 << 12];
+                for (std::size_t size = fread(buffer, 1, sizeof(buffer), file);
+                        size > 0;
+                        size = fread(buffer, 1, sizeof(buffer), file))
+                {
+                    hash(state, buffer, size);
+                }
+                fclose(file);
+            }
+
+            for (std::size_t i = 0; i < mesh_files.size(); ++i)
+            {
+                struct stat file_stat;
+                int64_t metadata[3] = {-1, 0, 0};
+
+                if (0 == stat(mesh_files[i].c_str(), &file_stat))
+                {
+                    metadata[0] = file_stat.st_size;
+                    metadata[1] = file_stat.st_mtim.tv_sec;
+                    metadata[2] = file_stat.st_mtim.tv_nsec;
+                }
+
+                hash(state, mesh_files[i]);
+                hash(state, metadata, sizeof(metadata));
+            }
+
+            char key[64];
+            snprintf(key, sizeof(key), "%s:%016llx", SCENE_CACHE_VERSION, static_cast<unsigned long long>(state));
+
+            return (key);
+        }
+
+
+        /**
+         * @brief Returns NULL if the cache is missing or outdated.
+         */
+        static osg::ref_ptr<osg::Group> read(const std::string & cache_file,
+                                             const std::string & key)
+        {
+            struct stat file_stat;
+            if (0 != stat(cache_file.c_str(), &file_stat))
+            {
+                return (NULL);
+            }
+
+            osg::ref_ptr<osg::Node> node = osgDB::readNodeFile(cache_file);
+            osg::ref_ptr<osg::Group> group = dynamic_cast<osg::Group *>(node.get());
+
+            if ((!group.valid())
+                    || (group->getDescriptions().empty())
+                    || (group->getDescriptions().front() != key))
+            {
+                return (NULL);
+            }
+
+            return (group);
+        }
+
+
+        /**
+         * @brief Saves the scene, failures are reported but not fatal.
+         */
+        static void write(  osg::ref_ptr<osg::Group> group,
+                            const std::string & cache_file,
+                            const std::string & key)
+        {
+            group->getDescriptions().clear();
+            group->addDescription(key);
+
+            // textures are embedded to make the cache independent of the mesh directory
+            osg::ref_ptr<osgDB::Options> options = new osgDB::Options("WriteImageHint=IncludeData");
+
+            if (osgDB::writeNodeFile(*group, cache_file, options.get()))
+            {
+                std::cout << "Saved scene cache `" << cache_file << "`" << std::endl;
+            }
+            else
+            {
+                std::cout << "Cannot save scene cache `" << cache_file << "`" << std::endl;
+                remove(cache_file.c_str());
+            }
+        }
+};
@@ -0,0 +1,106 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Scene level data file with columns for animated shape parameters.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <sstream>
+
+
+/**
+ * @brief Data file, each line of which contains parameters of all animated
+ * shapes for one iteration, the first line corresponds to iteration 0.
+ *
+ * A line is parsed once per iteration into a contiguous buffer, shapes
+ * access their parameters by column index.
+ */
+class ShapeData : public osg::Referenced
+{
+    protected:
+        std::string                 data_file_;
+        osg::ref_ptr<PoseSource>    source_;
+        /// index of the line of data_file_, which is read next
+        std::ptrdiff_t              next_frame_;
+
+
+    public:
+        std::vector<double>         values_;
+
+
+    public:
+        ShapeData(  const std::string & data_file,
+                    const std::size_t column_number,
+                    const std::size_t prefetch_depth = 0)
+        {
+            data_file_ = data_file;
+            values_.assign(column_number, 0.0);
+            next_frame_ = 0;
+
+            source_ = prefetchPoseSource(data_file_, new TextPoseSource(data_file_), column_number, prefetch_depth);
+        }
+
+
+        /**
+         * @brief Throws if columns [column, column + number) do not exist.
+         */
+        void checkColumns(  const std::ptrdiff_t column,
+                            const std::size_t number) const
+        {
+            if ((column < 0) || (column + number > values_.size()))
+            {
+                std::stringstream message;
+                message << "In " << __func__ << "() // Columns " << column << "-" << column + number - 1
+                        << " are not in the shape data file `" << data_file_ << "` with "
+                        << values_.size() << " columns.";
+                throw std::runtime_error(message.str());
+            }
+        }
+
+
+        const double * getColumns(const std::ptrdiff_t column) const
+        {
+            return (&values_[column]);
+        }
+
+
+        osg::Vec3 getVec3(const std::ptrdiff_t column) const
+        {
+            return (osg::Vec3(values_[column], values_[column + 1], values_[column + 2]));
+        }
+
+
+        osg::Vec4 getVec4(const std::ptrdiff_t column) const
+        {
+            return (osg::Vec4(values_[column], values_[column + 1], values_[column + 2], values_[column + 3]));
+        }
+
+
+        /**
+         * @brief Reads the line corresponding to the iteration, the values
+         * of the last line are kept after the end of the file.
+         */
+        void update(const std::ptrdiff_t iteration)
+        {
+            if (iteration + 1 == next_frame_)
+            {
+                return;
+            }
+            moveToFrame(*source_, next_frame_, iteration, values_);
+            next_frame_ = iteration + 1;
+
+            source_->readFrame(values_);
+        }
+
+
+        void printStatistics() const
+        {
+            source_->printStatistics();
+        }
+};
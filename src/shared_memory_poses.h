@@ -0,0 +1,460 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Transport of poses through POSIX shared memory.
+
+    The header has no dependencies besides the C++ standard library and
+    POSIX, so that it can be included by simulators and controllers.
+
+    Layout of a shared memory object (native byte order):
+        1. SharedMemoryPosesHeader (64 bytes);
+        2. body_number_ XYZ-RPY vectors (6 doubles per body).
+
+    The writer never blocks, the reader uses the seqlock protocol:
+        writer: sequence_ += 1 (odd: update in progress), write timestamp
+                and poses, sequence_ += 1 (even: consistent);
+        reader: load sequence_, retry if odd, copy timestamp and poses, load
+                sequence_ again, retry if it changed.
+
+    The number of retries is bounded, since a writer may die in the middle
+    of an update. A restarted writer creates a new object or resizes the
+    existing one in place, readers remap the object when there are no
+    updates for a while and it is replaced, or when it grows.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+
+#define SHARED_MEMORY_POSES_MAGIC   "ORVSHM"
+#define SHARED_MEMORY_POSES_VERSION 1
+/// retries of a read before it is given up until the next call
+#define SHARED_MEMORY_POSES_MAX_RETRIES 1000
+/// number of reads without updates, after which the object is checked
+#define SHARED_MEMORY_POSES_IDLE_READS 1000
+
+
+struct SharedMemoryPosesHeader
+{
+    char        magic_[8];
+    uint32_t    version_;
+    uint32_t    body_number_;
+    /// odd while the writer updates the poses, accessed atomically
+    uint64_t    sequence_;
+    /// time of the poses, provided by the writer
+    double      timestamp_;
+    /// CLOCK_MONOTONIC time of the update [ns], used to measure latency
+    uint64_t    write_time_;
+    char        padding_[24];
+
+
+    static std::size_t getSize(const std::size_t body_number)
+    {
+        return (sizeof(SharedMemoryPosesHeader) + body_number * 6 * sizeof(double));
+    }
+
+
+    double * getPoses()
+    {
+        return (reinterpret_cast<double *>(this + 1));
+    }
+
+
+    bool isValid() const
+    {
+        return ( (0 == memcmp(magic_, SHARED_MEMORY_POSES_MAGIC, sizeof(SHARED_MEMORY_POSES_MAGIC)))
+                && (SHARED_MEMORY_POSES_VERSION == version_));
+    }
+
+
+    static uint64_t getMonotonicTime()
+    {
+        struct timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return (static_cast<uint64_t>(time.tv_sec) * 1000000000ULL + time.tv_nsec);
+    }
+};
+
+
+
+/**
+ * @brief Creates a shared memory object and publishes poses in it.
+ *
+ * Usage:
+ *      SharedMemoryPosesWriter writer("/robot_poses", body_number);
+ *      writer.write(poses, time);  // 6 * body_number values
+ */
+class SharedMemoryPosesWriter
+{
+    protected:
+        std::string                 name_;
+        std::size_t                 size_;
+        SharedMemoryPosesHeader *   header_;
+
+
+    public:
+        /**
+         * @param[in] name  name of the shared memory object, e.g., '/poses'
+         * @param[in] body_number
+         */
+        SharedMemoryPosesWriter(const std::string & name,
+                                const std::size_t body_number)
+        {
+            name_ = name;
+            size_ = SharedMemoryPosesHeader::getSize(body_number);
+
+            const int descriptor = shm_open(name_.c_str(), O_CREAT | O_RDWR, 0644);
+            if (descriptor < 0)
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot create shared memory: " + name_);
+            }
+
+            if (0 != ftruncate(descriptor, size_))
+            {
+                ::close(descriptor);
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot resize shared memory: " + name_);
+            }
+
+            void * memory = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+            ::close(descriptor);
+            if (MAP_FAILED == memory)
+            {
+                throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot map shared memory: " + name_);
+            }
+            header_ = static_cast<SharedMemoryPosesHeader *>(memory);
+
+
+            // the object may be reused, readers must not see a valid header
+            // before the layout is consistent
+            __atomic_store_n(&header_->sequence_, 1, __ATOMIC_RELEASE);
+            header_->version_ = 0;
+            header_->body_number_ = body_number;
+            header_->timestamp_ = 0.0;
+            header_->write_time_ = 0;
+            memset(header_->getPoses(), 0, body_number * 6 * sizeof(double));
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            memcpy(header_->magic_, SHARED_MEMORY_POSES_MAGIC, sizeof(SHARED_MEMORY_POSES_MAGIC));
+            header_->version_ = SHARED_MEMORY_POSES_VERSION;
+            // even, but there are no poses until the first write()
+            __atomic_store_n(&header_->sequence_, 0, __ATOMIC_RELEASE);
+        }
+
+
+        /**
+         * @param[in] unlink    remove the shared memory object, readers
+         *                      keep their mappings
+         */
+        void close(const bool unlink = true)
+        {
+            if (NULL != header_)
+            {
+                munmap(header_, size_);
+                header_ = NULL;
+
+                if (unlink)
+                {
+                    shm_unlink(name_.c_str());
+                }
+            }
+        }
+
+
+        ~SharedMemoryPosesWriter()
+        {
+            close();
+        }
+
+
+        /**
+         * @param[in] poses     6 values (XYZ-RPY) per body
+         * @param[in] timestamp
+         */
+        void write(const double * poses, const double timestamp = 0.0)
+        {
+            const uint64_t sequence = __atomic_load_n(&header_->sequence_, __ATOMIC_RELAXED);
+
+            __atomic_store_n(&header_->sequence_, sequence + 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+
+            header_->timestamp_ = timestamp;
+            memcpy(header_->getPoses(), poses, header_->body_number_ * 6 * sizeof(double));
+            header_->write_time_ = SharedMemoryPosesHeader::getMonotonicTime();
+
+            __atomic_store_n(&header_->sequence_, sequence + 2, __ATOMIC_RELEASE);
+        }
+
+
+        void write(const std::vector<double> & poses, const double timestamp = 0.0)
+        {
+            write(poses.data(), timestamp);
+        }
+
+
+    private:
+        SharedMemoryPosesWriter(const SharedMemoryPosesWriter &);
+        SharedMemoryPosesWriter & operator=(const SharedMemoryPosesWriter &);
+};
+
+
+
+/**
+ * @brief Reads consistent snapshots of poses without blocking the writer.
+ */
+class SharedMemoryPosesReader
+{
+    protected:
+        std::string                 name_;
+        std::size_t                 size_;
+        SharedMemoryPosesHeader *   header_;
+        uint64_t                    last_sequence_;
+        /// identifies the mapped object
+        ino_t                       inode_;
+        std::size_t                 idle_read_counter_;
+
+
+    protected:
+        void detach()
+        {
+            if (NULL != header_)
+            {
+                munmap(header_, size_);
+                header_ = NULL;
+            }
+            last_sequence_ = 0;
+            idle_read_counter_ = 0;
+        }
+
+
+        /**
+         * @brief True if the object was removed or replaced by a restarted
+         * writer.
+         */
+        bool isReplaced() const
+        {
+            const int descriptor = shm_open(name_.c_str(), O_RDONLY, 0);
+            if (descriptor < 0)
+            {
+                return (true);
+            }
+
+            struct stat object_stat;
+            const bool replaced = (0 != fstat(descriptor, &object_stat)) || (object_stat.st_ino != inode_);
+            ::close(descriptor);
+
+            return (replaced);
+        }
+
+
+    public:
+        /// number of snapshots discarded due to concurrent updates
+        std::size_t                 retry_counter_;
+        /// number of updates by the writer, which were never read
+        std::size_t                 skip_counter_;
+        /// number of times the object was mapped again
+        std::size_t                 reattach_counter_;
+
+
+    public:
+        SharedMemoryPosesReader(const std::string & name)
+        {
+            name_ = name;
+            size_ = 0;
+            header_ = NULL;
+            last_sequence_ = 0;
+            inode_ = 0;
+            idle_read_counter_ = 0;
+            retry_counter_ = 0;
+            skip_counter_ = 0;
+            reattach_counter_ = 0;
+        }
+
+
+        ~SharedMemoryPosesReader()
+        {
+            detach();
+        }
+
+
+        /**
+         * @brief Maps the shared memory object.
+         *
+         * @return false if the object does not exist or is not initialized
+         * by the writer yet.
+         */
+        bool attach()
+        {
+            if (NULL != header_)
+            {
+                return (true);
+            }
+
+            const int descriptor = shm_open(name_.c_str(), O_RDONLY, 0);
+            if (descriptor < 0)
+            {
+                return (false);
+            }
+
+            struct stat object_stat;
+            if ((0 != fstat(descriptor, &object_stat))
+                    || (static_cast<std::size_t>(object_stat.st_size) < sizeof(SharedMemoryPosesHeader)))
+            {
+                ::close(descriptor);
+                return (false);
+            }
+
+            size_ = object_stat.st_size;
+            inode_ = object_stat.st_ino;
+            void * memory = mmap(NULL, size_, PROT_READ, MAP_SHARED, descriptor, 0);
+            ::close(descriptor);
+            if (MAP_FAILED == memory)
+            {
+                return (false);
+            }
+
+            header_ = static_cast<SharedMemoryPosesHeader *>(memory);
+            if ((!header_->isValid())
+                    || (SharedMemoryPosesHeader::getSize(header_->body_number_) > size_))
+            {
+                munmap(header_, size_);
+                header_ = NULL;
+                return (false);
+            }
+
+            return (true);
+        }
+
+
+        std::size_t getBodyNumber() const
+        {
+            return (NULL == header_ ? 0 : header_->body_number_);
+        }
+
+
+        /**
+         * @brief Copies the latest poses if they changed since the last call.
+         *
+         * @param[out] poses    6 values per body, must be preallocated
+         *                      for the number of bodies in the object
+         * @param[out] timestamp
+         * @param[out] write_time   see SharedMemoryPosesHeader::write_time_
+         *
+         * @return false if there is no new update or a consistent snapshot
+         * could not be taken.
+         *
+         * @throw std::runtime_error if the number of bodies does not match
+         * the size of poses.
+         */
+        bool read(  std::vector<double> & poses,
+                    double & timestamp,
+                    uint64_t & write_time)
+        {
+            if (!attach())
+            {
+                return (false);
+            }
+
+            for (std::size_t retry = 0; ; ++retry)
+            {
+                if (retry > SHARED_MEMORY_POSES_MAX_RETRIES)
+                {
+                    // the writer may have died in the middle of an update
+                    if (++idle_read_counter_ >= SHARED_MEMORY_POSES_IDLE_READS)
+                    {
+                        checkReplaced();
+                    }
+                    return (false);
+                }
+
+                const uint64_t sequence = __atomic_load_n(&header_->sequence_, __ATOMIC_ACQUIRE);
+
+                if ((sequence == last_sequence_) || (0 == sequence))
+                {
+                    if (++idle_read_counter_ >= SHARED_MEMORY_POSES_IDLE_READS)
+                    {
+                        checkReplaced();
+                    }
+                    return (false);
+                }
+                if (0 != sequence % 2)
+                {
+                    ++retry_counter_;
+                    continue;
+                }
+
+                // a restarted writer may resize the object in place, the
+                // number of bodies is validated before copying
+                const std::size_t body_number = __atomic_load_n(&header_->body_number_, __ATOMIC_RELAXED);
+                const bool consistent_size = (SharedMemoryPosesHeader::getSize(body_number) <= size_)
+                                                && (body_number * 6 == poses.size());
+                if (consistent_size)
+                {
+                    timestamp = header_->timestamp_;
+                    write_time = header_->write_time_;
+                    memcpy(poses.data(), header_->getPoses(), poses.size() * sizeof(double));
+                }
+
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if (__atomic_load_n(&header_->sequence_, __ATOMIC_RELAXED) != sequence)
+                {
+                    ++retry_counter_;
+                    continue;
+                }
+
+                if (!consistent_size)
+                {
+                    if (SharedMemoryPosesHeader::getSize(body_number) > size_)
+                    {
+                        // the object grew, it is mapped again on the next call
+                        detach();
+                        ++reattach_counter_;
+                        return (false);
+                    }
+                    throw std::runtime_error(std::string("In ") + __func__ + "() // Wrong number of bodies in shared memory: " + name_);
+                }
+
+                // the sequence restarts if the object is reused by a new writer
+                if ((last_sequence_ > 0) && (sequence > last_sequence_))
+                {
+                    skip_counter_ += (sequence - last_sequence_) / 2 - 1;
+                }
+                last_sequence_ = sequence;
+                idle_read_counter_ = 0;
+                return (true);
+            }
+        }
+
+
+        /**
+         * @brief Unmaps the object if it was replaced, the new object is
+         * mapped on the next read().
+         */
+        void checkReplaced()
+        {
+            idle_read_counter_ = 0;
+            if ((NULL != header_) && isReplaced())
+            {
+                detach();
+                ++reattach_counter_;
+            }
+        }
+
+
+    private:
+        SharedMemoryPosesReader(const SharedMemoryPosesReader &);
+        SharedMemoryPosesReader & operator=(const SharedMemoryPosesReader &);
+};
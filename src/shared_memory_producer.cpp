@@ -0,0 +1,233 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Synthetic producer of poses in shared memory, see
+    shared_memory_poses.h. Feeds the visualizer ('data_file: shm:/name') or
+    measures the transport latency with a built-in consumer.
+*/
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <algorithm>
+#include <exception>
+
+#include "shared_memory_poses.h"
+
+void usage()
+{
+    printf("Options:\n");
+    printf("    -n name of the shared memory object (default '/orv_poses')\n");
+    printf("    -b number of bodies (default 40)\n");
+    printf("    -r update rate [Hz] (default 1000)\n");
+    printf("    -t duration [s] (default 10)\n");
+    printf("    -c run a consumer thread and report the latency\n");
+}
+
+
+struct ConsumerResult
+{
+    std::size_t             frames_;
+    std::size_t             retries_;
+    std::size_t             skipped_;
+    /// [ns]
+    std::vector<uint64_t>   latencies_;
+    std::exception_ptr      error_;
+};
+
+
+/**
+ * @brief Polls the shared memory object until stopped.
+ */
+void consume(   const std::string & name,
+                const std::size_t body_number,
+                const std::atomic<bool> & stop,
+                ConsumerResult & result)
+{
+    SharedMemoryPosesReader reader(name);
+    std::vector<double>     poses(body_number * 6);
+    double                  timestamp = 0.0;
+    uint64_t                write_time = 0;
+
+    try
+    {
+        while (!stop)
+        {
+            if (reader.read(poses, timestamp, write_time))
+            {
+                result.latencies_.push_back(SharedMemoryPosesHeader::getMonotonicTime() - write_time);
+            }
+        }
+    }
+    catch (...)
+    {
+        // rethrown by the main thread
+        result.error_ = std::current_exception();
+    }
+
+    result.frames_ = result.latencies_.size();
+    result.retries_ = reader.retry_counter_;
+    result.skipped_ = reader.skip_counter_;
+}
+
+
+/**
+ * @brief Stops and joins the consumer thread when leaving the scope, e.g., on
+ * an exception, which would otherwise destroy a joinable thread.
+ */
+class ConsumerGuard
+{
+    protected:
+        std::atomic<bool> & stop_;
+        std::thread &       consumer_;
+
+
+    public:
+        ConsumerGuard(std::atomic<bool> & stop, std::thread & consumer)
+            : stop_(stop), consumer_(consumer)
+        {
+        }
+
+
+        void join()
+        {
+            stop_ = true;
+            if (consumer_.joinable())
+            {
+                consumer_.join();
+            }
+        }
+
+
+        ~ConsumerGuard()
+        {
+            join();
+        }
+};
+
+
+int main(int argc, char **argv)
+{
+    int option;
+
+    std::string name = "/orv_poses";
+    std::size_t body_number = 40;
+    double      rate = 1000.0;
+    double      duration = 10.0;
+    bool        run_consumer = false;
+
+    while ((option = getopt(argc, argv, "n:b:r:t:c")) != -1)
+    {
+        switch (option)
+        {
+            case 'n':
+                name = optarg;
+                break;
+            case 'b':
+                body_number = strtol(optarg, NULL, 10);
+                break;
+            case 'r':
+                rate = strtod(optarg, NULL);
+                break;
+            case 't':
+                duration = strtod(optarg, NULL);
+                break;
+            case 'c':
+                run_consumer = true;
+                break;
+            case '?':
+            default:
+                usage();
+                return(0);
+        }
+    }
+
+
+    try
+    {
+        if ((0 == body_number) || (rate <= 0.0))
+        {
+            throw std::runtime_error(std::string("In ") + __func__ + "() // Number of bodies and rate must be positive.");
+        }
+
+        SharedMemoryPosesWriter writer(name, body_number);
+        std::vector<double>     poses(body_number * 6);
+
+        std::atomic<bool>       stop(false);
+        ConsumerResult          consumer_result;
+        std::thread             consumer;
+        ConsumerGuard           consumer_guard(stop, consumer);
+        if (run_consumer)
+        {
+            consumer = std::thread(consume, name, body_number, std::cref(stop), std::ref(consumer_result));
+        }
+
+        std::cout << "Writing " << body_number << " bodies to `" << name << "` at "
+                  << rate << " Hz for " << duration << " s" << std::endl;
+
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        const std::size_t frame_number = static_cast<std::size_t>(duration * rate);
+        for (std::size_t i = 0; i < frame_number; ++i)
+        {
+            const double time = i / rate;
+
+            for (std::size_t j = 0; j < body_number; ++j)
+            {
+                double * pose = &poses[j * 6];
+
+                pose[0] = 0.5 * (j % 8);
+                pose[1] = 0.5 * (j / 8);
+                pose[2] = 0.5 + 0.2 * std::sin(2.0 * time + j);
+                pose[3] = 0.0;
+                pose[4] = 0.0;
+                pose[5] = std::fmod(time + 0.1 * j, 2.0 * M_PI);
+            }
+
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(time)));
+            writer.write(poses, time);
+        }
+
+
+        if (run_consumer)
+        {
+            // let the consumer pick up the last update
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            consumer_guard.join();
+            if (consumer_result.error_)
+            {
+                std::rethrow_exception(consumer_result.error_);
+            }
+
+            std::vector<uint64_t> & latencies = consumer_result.latencies_;
+            std::sort(latencies.begin(), latencies.end());
+
+            std::cout << "Consumer: " << consumer_result.frames_ << " of " << frame_number << " updates read, "
+                      << consumer_result.skipped_ << " skipped, " << consumer_result.retries_ << " retries" << std::endl;
+            if (!latencies.empty())
+            {
+                std::cout << std::fixed << std::setprecision(2)
+                          << "Latency [us]: median " << latencies[latencies.size() / 2] * 1e-3
+                          << ", p99 " << latencies[latencies.size() * 99 / 100] * 1e-3
+                          << ", max " << latencies.back() * 1e-3 << std::endl;
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << std::endl;
+        return (1);
+    }
+
+    return 0;
+}
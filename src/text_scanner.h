@@ -0,0 +1,231 @@
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief Locale independent scanner of floating point numbers, which
+    operates in place on null terminated buffers and never allocates.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+
+class TextScanner
+{
+    protected:
+        static bool isDigit(const char c)
+        {
+            return ((c >= '0') && (c <= '9'));
+        }
+
+
+        static double scaleByPowerOf10(const double value, const int exponent)
+        {
+            // all powers of 10 up to 1e22 are exact in double precision
+            static const double powers_of_10[] = {
+                1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+            if ((exponent >= 0) && (exponent <= 22))
+            {
+                return (value * powers_of_10[exponent]);
+            }
+            if ((exponent < 0) && (exponent >= -22))
+            {
+                return (value / powers_of_10[-exponent]);
+            }
+            return (value * pow(10.0, exponent));
+        }
+
+
+    public:
+        enum Status
+        {
+            OK = 0,
+            MALFORMED_VALUE = 1,
+            TOO_FEW_VALUES = 2,
+            TOO_MANY_VALUES = 3
+        };
+
+
+    public:
+        static bool isSpace(const char c)
+        {
+            return ((' ' == c) || ('\t' == c) || ('\r' == c) || ('\n' == c) || ('\v' == c) || ('\f' == c));
+        }
+
+
+        static void skipSpaces(const char * & cursor)
+        {
+            while (isSpace(*cursor))
+            {
+                ++cursor;
+            }
+        }
+
+
+        /**
+         * @brief Parses a decimal number, e.g. '-1.25e-3', at the cursor.
+         *
+         * At most 19 significant digits are taken into account, the result
+         * may differ from strtod() by one unit in the last place.
+         *
+         * @param[in,out] cursor    advanced past the number on success
+         * @param[out] value
+         *
+         * @return false if there is no valid number at the cursor.
+         */
+        static bool scanDouble(const char * & cursor, double & value)
+        {
+            const char * c = cursor;
+            bool negative = false;
+
+            if ('-' == *c)
+            {
+                negative = true;
+                ++c;
+            }
+            else if ('+' == *c)
+            {
+                ++c;
+            }
+
+
+            uint64_t    mantissa = 0;
+            int         significant_digits = 0;
+            int         exponent = 0;
+            bool        has_digits = false;
+
+            for (; isDigit(*c); ++c)
+            {
+                has_digits = true;
+                if (significant_digits < 19)
+                {
+                    mantissa = mantissa * 10 + (*c - '0');
+                    if (0 != mantissa)
+                    {
+                        ++significant_digits;
+                    }
+                }
+                else
+                {
+                    ++exponent;
+                }
+            }
+
+            if ('.' == *c)
+            {
+                for (++c; isDigit(*c); ++c)
+                {
+                    has_digits = true;
+                    if (significant_digits < 19)
+                    {
+                        mantissa = mantissa * 10 + (*c - '0');
+                        if (0 != mantissa)
+                        {
+                            ++significant_digits;
+                        }
+                        --exponent;
+                    }
+                }
+            }
+
+            if (!has_digits)
+            {
+                return (false);
+            }
+
+
+            if (('e' == *c) || ('E' == *c))
+            {
+                ++c;
+
+                bool negative_exponent = false;
+                if ('-' == *c)
+                {
+                    negative_exponent = true;
+                    ++c;
+                }
+                else if ('+' == *c)
+                {
+                    ++c;
+                }
+
+                if (!isDigit(*c))
+                {
+                    return (false);
+                }
+
+                int explicit_exponent = 0;
+                for (; isDigit(*c); ++c)
+                {
+                    if (explicit_exponent < 10000)
+                    {
+                        explicit_exponent = explicit_exponent * 10 + (*c - '0');
+                    }
+                }
+                exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+            }
+
+
+            // a number must be followed by a separator
+            if (('\0' != *c) && (!isSpace(*c)))
+            {
+                return (false);
+            }
+
+
+            value = scaleByPowerOf10(static_cast<double>(mantissa), exponent);
+            if (negative)
+            {
+                value = -value;
+            }
+            cursor = c;
+
+            return (true);
+        }
+
+
+        /**
+         * @brief Parses exactly value_number whitespace separated numbers.
+         *
+         * @param[in] line  null terminated buffer
+         * @param[out] values
+         * @param[in] value_number
+         * @param[out] parsed_number  number of parsed values, on failure
+         *                            points to the offending column
+         *
+         * @return status
+         */
+        static Status scanLine( const char * line,
+                                double * values,
+                                const std::size_t value_number,
+                                std::size_t & parsed_number)
+        {
+            const char * cursor = line;
+
+            for (parsed_number = 0; ; ++parsed_number)
+            {
+                skipSpaces(cursor);
+
+                if ('\0' == *cursor)
+                {
+                    return (parsed_number == value_number ? OK : TOO_FEW_VALUES);
+                }
+
+                if (parsed_number == value_number)
+                {
+                    return (TOO_MANY_VALUES);
+                }
+
+                if (!scanDouble(cursor, values[parsed_number]))
+                {
+                    return (MALFORMED_VALUE);
+                }
+            }
+        }
+};
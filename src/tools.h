@@ -9,18 +9,74 @@
 
 #pragma once
 
-#include <iomanip>
+#include <string.h>
 
+#include <set>
+#include <atomic>
+
+#include "frame_profiler.h"
+
+
+/**
+ * @brief Saves the contents of the frame buffer after drawing.
+ *
+ * Pixels are read to two alternating pixel buffer objects: the transfer
+ * for a frame is started when it is drawn, and the buffer is mapped when
+ * the next frame is drawn, so that the draw thread does not wait for the
+ * transfer. Images are passed to an ImageWriter with their indices. An extra
+ * frame must be drawn after the last snapshot to collect its pixels, see
+ * isPending().
+ *
+ * The draw thread may run concurrently with the main loop, flags shared
+ * with it are atomic.
+ */
 // https://groups.google.com/forum/#!topic/osg-users/Sv1WCX4zFXc
 class SnapImageDrawCallback : public osg::Camera::DrawCallback
 {
+    protected:
+        /**
+         * @brief Maps a pixel buffer and passes its contents to the writers.
+         */
+        void collectPixels(osg::GLExtensions * extensions, const std::size_t buffer) const
+        {
+            osg::ref_ptr<osg::Image> image = new osg::Image;
+            image->allocateImage(width_, height_, 1, GL_RGB, GL_UNSIGNED_BYTE, 1);
+
+            extensions->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, pixel_buffers_[buffer]);
+            const void * pixels = extensions->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+            if (NULL != pixels)
+            {
+                memcpy(image->data(), pixels, image->getTotalSizeInBytes());
+                extensions->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+            }
+            extensions->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+
+            if (NULL != pixels)
+            {
+                writer_->push(image, pending_index_[buffer]);
+            }
+
+            // the image must be in the writer before finish() is called
+            pending_[buffer] = false;
+        }
+
+
     public:
-        SnapImageDrawCallback(  const std::string & filename_prefix,
-                                const std::string & filename_suffix)
+        SnapImageDrawCallback(osg::ref_ptr<ImageWriter> writer)
         {
             snap_image_on_next_frame_ = false;
-            filename_prefix_ = filename_prefix;
-            filename_suffix_ = filename_suffix;
+            writer_ = writer;
+            index_ = 0;
+
+            width_ = 0;
+            height_ = 0;
+            current_buffer_ = 0;
+            for (std::size_t i = 0; i < 2; ++i)
+            {
+                pixel_buffers_[i] = 0;
+                pending_[i] = false;
+                pending_index_[i] = 0;
+            }
         }
 
 
@@ -31,48 +87,260 @@ class SnapImageDrawCallback : public osg::Camera::DrawCallback
         }
 
 
-        virtual void operator () (const osg::Camera& camera) const
+        /**
+         * @brief True if a snapshot is not taken yet or its pixels are not
+         * collected yet.
+         */
+        bool isPending() const
         {
-            if (snap_image_on_next_frame_)
+            // the draw thread sets pending_ before it resets the request
+            return (snap_image_on_next_frame_ || pending_[0] || pending_[1]);
+        }
+
+
+        /**
+         * @brief Blocks until all images are written.
+         */
+        void finish()
+        {
+            writer_->wait();
+        }
+
+
+        virtual void operator () (osg::RenderInfo& render_info) const
+        {
+            FrameProfiler::ScopedTimer timer(FrameProfiler::SNAPSHOT);
+
+            const osg::Camera & camera = *render_info.getCurrentCamera();
+            osg::GLExtensions * extensions = osg::GLExtensions::Get(render_info.getState()->getContextID(), true);
+
+            int x       = camera.getViewport()->x();
+            int y       = camera.getViewport()->y();
+
+            int width   = camera.getViewport()->width();
+            int height  = camera.getViewport()->height();
+
+
+            if (!extensions->isPBOSupported)
             {
-                int x       = camera.getViewport()->x();
-                int y       = camera.getViewport()->y();
+                if (snap_image_on_next_frame_)
+                {
+                    osg::ref_ptr<osg::Image> image = new osg::Image;
+                    image->readPixels(x, y, width, height, GL_RGB, GL_UNSIGNED_BYTE, 1);
+                    writer_->push(image, index_);
 
-                int width   = camera.getViewport()->width();
-                int height  = camera.getViewport()->height();
+                    snap_image_on_next_frame_ = false;
+                }
+                return;
+            }
 
-                osg::ref_ptr<osg::Image> image = new osg::Image;
 
+            // collect pixels of the previous frame
+            const std::size_t previous_buffer = 1 - current_buffer_;
+            if (pending_[previous_buffer])
+            {
+                collectPixels(extensions, previous_buffer);
+            }
 
-                std::stringstream filename;
-                filename    << filename_prefix_
-                            << std::setw(10) << std::setfill('0') << index_
-                            << filename_suffix_;
 
-                image->readPixels(x, y, width, height, GL_RGB, GL_UNSIGNED_BYTE);
-                if (osgDB::writeImageFile(*image, filename.str()))
+            // no pixels are pending at this point
+            if ((width != width_) || (height != height_))
+            {
+                width_ = width;
+                height_ = height;
+
+                for (std::size_t i = 0; i < 2; ++i)
                 {
-                    std::cout  << "Saved screen image to `"<< filename.str() <<"`"<< std::endl;
+                    if (0 == pixel_buffers_[i])
+                    {
+                        extensions->glGenBuffers(1, &pixel_buffers_[i]);
+                    }
+                    extensions->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, pixel_buffers_[i]);
+                    extensions->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, width_ * height_ * 3, NULL, GL_STREAM_READ_ARB);
                 }
+                extensions->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+            }
+
+
+            // start transfer of the current frame
+            if (snap_image_on_next_frame_)
+            {
+                // the alignment is restored for other readbacks
+                GLint alignment = 4;
+                glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+
+                extensions->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, pixel_buffers_[current_buffer_]);
+                glPixelStorei(GL_PACK_ALIGNMENT, 1);
+                glReadPixels(x, y, width_, height_, GL_RGB, GL_UNSIGNED_BYTE, 0);
+                glPixelStorei(GL_PACK_ALIGNMENT, alignment);
+                extensions->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+
+                pending_[current_buffer_] = true;
+                pending_index_[current_buffer_] = index_;
+                current_buffer_ = previous_buffer;
 
                 snap_image_on_next_frame_ = false;
             }
         }
 
     protected:
-        std::string     filename_prefix_;
-        std::string     filename_suffix_;
-        std::size_t     index_;
+        osg::ref_ptr<ImageWriter>   writer_;
+        std::size_t                 index_;
 
 
-        mutable bool    snap_image_on_next_frame_;
+        mutable std::atomic<bool>   snap_image_on_next_frame_;
+
+        mutable int                 width_;
+        mutable int                 height_;
+        mutable GLuint              pixel_buffers_[2];
+        mutable std::atomic<bool>   pending_[2];
+        mutable std::size_t         pending_index_[2];
+        mutable std::size_t         current_buffer_;
 };
 
 
 
+/**
+ * @brief Makes the viewer render to an offscreen pbuffer instead of a window.
+ *
+ * The pbuffer is provided by the windowing system OpenSceneGraph is built
+ * with, e.g., GLX with a virtual X server and a software renderer (Xvfb +
+ * llvmpipe) on machines without GPU.
+ */
+void setUpOffscreenContext( osgViewer::Viewer & viewer,
+                            const int width,
+                            const int height)
+{
+    osg::ref_ptr<osg::GraphicsContext::Traits> traits = new osg::GraphicsContext::Traits;
+
+    traits->readDISPLAY();
+    traits->x = 0;
+    traits->y = 0;
+    traits->width = width;
+    traits->height = height;
+    traits->windowDecoration = false;
+    traits->doubleBuffer = false;
+    traits->sharedContext = 0;
+    traits->pbuffer = true;
+
+    osg::ref_ptr<osg::GraphicsContext> context = osg::GraphicsContext::createGraphicsContext(traits.get());
+    if ((!context.valid()) || (!context->valid()))
+    {
+        throw std::runtime_error(std::string("In ") + __func__ + "() // Cannot create an offscreen pbuffer context.");
+    }
+
+
+    osg::Camera * camera = viewer.getCamera();
+
+    camera->setGraphicsContext(context.get());
+    camera->setViewport(new osg::Viewport(0, 0, width, height));
+    camera->setProjectionMatrixAsPerspective(30.0, static_cast<double>(width) / height, 1.0, 10000.0);
+    camera->setDrawBuffer(GL_FRONT);
+    camera->setReadBuffer(GL_FRONT);
+
+    viewer.setThreadingModel(osgViewer::Viewer::SingleThreaded);
+}
+
+
+
 osg::Quat convertRPYtoQuaternion(const osg::Vec3 & rpy)
 {
     return (osg::Quat(  rpy.x(), osg::Vec3(1,0,0),
                         rpy.y(), osg::Vec3(0,1,0),
                         rpy.z(), osg::Vec3(0,0,1)));
 }
+
+
+
+/**
+ * @brief Counts distinct nodes in a subgraph.
+ */
+class NodeCounter : public osg::NodeVisitor
+{
+    public:
+        std::set<const osg::Node *>  nodes_;
+
+
+    public:
+        NodeCounter() : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+        {
+        }
+
+
+        void apply(osg::Node & node)
+        {
+            if (nodes_.insert(&node).second)
+            {
+                traverse(node);
+            }
+        }
+};
+
+
+std::size_t countNodes(osg::Node * node)
+{
+    NodeCounter counter;
+    node->accept(counter);
+    return (counter.nodes_.size());
+}
+
+
+
+/**
+ * @brief Makes OpenSceneGraph measure cull and draw traversals, see
+ * addRenderingTimes().
+ */
+void enableRenderingStats(osgViewer::Viewer & viewer)
+{
+    if ((NULL != viewer.getViewerStats()) && (NULL != viewer.getCamera()->getStats()))
+    {
+        viewer.getViewerStats()->collectStats("frame_rate", true);
+        viewer.getCamera()->getStats()->collectStats("rendering", true);
+    }
+}
+
+
+/**
+ * @brief Passes cull and draw times of the last frame to the profiler.
+ *
+ * @param[in] viewer
+ * @param[in] frame_begin   time of the call to viewer.frame(), times
+ *                          measured by OpenSceneGraph are relative to it
+ */
+void addRenderingTimes( osgViewer::Viewer & viewer,
+                        const FrameProfiler::Clock::time_point & frame_begin)
+{
+    osg::Stats * viewer_stats = viewer.getViewerStats();
+    osg::Stats * camera_stats = viewer.getCamera()->getStats();
+    if ((NULL == viewer_stats) || (NULL == camera_stats) || (NULL == viewer.getFrameStamp()))
+    {
+        return;
+    }
+
+    const unsigned int frame_number = viewer.getFrameStamp()->getFrameNumber();
+    double reference_time = 0.0;
+    if (!viewer_stats->getAttribute(frame_number, "Reference time", reference_time))
+    {
+        return;
+    }
+
+    const FrameProfiler::Phase phases[] = {FrameProfiler::CULL, FrameProfiler::DRAW};
+    const std::string names[] = {"Cull traversal", "Draw traversal"};
+
+    for (std::size_t i = 0; i < 2; ++i)
+    {
+        double begin = 0.0;
+        double end = 0.0;
+
+        if (camera_stats->getAttribute(frame_number, names[i] + " begin time", begin)
+                && camera_stats->getAttribute(frame_number, names[i] + " end time", end))
+        {
+            FrameProfiler::getInstance().addPhase(
+                    phases[i],
+                    frame_begin + std::chrono::duration_cast<FrameProfiler::Clock::duration>(
+                        std::chrono::duration<double>(begin - reference_time)),
+                    frame_begin + std::chrono::duration_cast<FrameProfiler::Clock::duration>(
+                        std::chrono::duration<double>(end - reference_time)));
+        }
+    }
+}
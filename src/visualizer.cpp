@@ -1,188 +1,496 @@
-/**
-    @file
-    @author  Alexander Sherikov
-    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
-    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
-
-    @brief
-*/
-
-#include <osg/Node>
-#include <osg/Group>
-#include <osg/Geode>
-#include <osg/Geometry>
-#include <osg/Texture2D>
-#include <osgDB/ReadFile>
-#include <osgViewer/Viewer>
-#include <osg/PositionAttitudeTransform>
-#include <osgGA/TrackballManipulator>
-
-#include <osg/Node>
-#include <osgDB/ReadFile>
-
-#include <osg/Camera>
-#include <osgDB/WriteFile>
-
-#include <osg/ShapeDrawable>
-
-#include <osg/LineWidth>
-
-#include <unistd.h>
-#include <math.h>
-
-#include "tools.h"
-#include "drawing_functions.h"
-#include "configuration.h"
-#include "robots.h"
-
-void usage()
-{
-    printf("Options:\n");
-    printf("    -c 'configuration file' (required)\n");
-    printf("    -e (exit when the end of input file is reached)\n");
-    printf("    -d duration (duration of a sleep between displaying two configurations, ms)\n");
-}
-
-
-int main(int argc, char **argv)
-{
-    int option;
-
-    bool automatic_exit     = false;
-    char *config_file_name  = NULL;
-    int sleep_duration = 0;
-
-    while ((option = getopt(argc, argv, "ec:d:")) != -1)
-    {
-        switch (option)
-        {
-            case 'c':
-                config_file_name = optarg;
-                break;
-            case 'e':
-                automatic_exit = true;
-                break;
-            case 'd':
-                sleep_duration = strtol(optarg, NULL, 10) * 1000;
-                break;
-            case '?':
-            default:
-                usage();
-                return(0);
-        }
-    }
-
-
-
-    if (NULL == config_file_name)
-    {
-        usage();
-        return(0);
-    }
-    try
-    {
-        Configuration config(config_file_name);
-
-
-        osg::ref_ptr<osg::Group> root = new osg::Group();
-
-        root->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::ON);
-        root->getOrCreateStateSet()->setMode(GL_LIGHT0, osg::StateAttribute::ON);
-        root->getOrCreateStateSet()->setMode(GL_NORMALIZE, osg::StateAttribute::ON);
-
-
-        std::vector<osg::ref_ptr<Robot> > robots;
-
-        for (std::size_t i = 0; i < config.robots_.size(); ++i)
-        {
-            osg::ref_ptr<Robot> robot = new Robot;
-            robot->load(  config.robots_[i].robot_description_file_,
-                               config.robots_[i].data_file_);
-            root->addChild(robot->robot_group_.get());
-
-            robots.push_back(robot);
-        }
-
-
-        drawGroundGrid(root);
-        drawFrame(root);
-
-
-        // define a group, which contains all simple shapes
-        osg::ref_ptr<osg::Group> shapes_group = new osg::Group();
-        root->addChild(shapes_group);
-
-
-
-        //The final step is to set up and enter a simulation loop.
-        osgViewer::Viewer viewer;
-        viewer.setSceneData( root );
-
-
-        // camera position
-        osgGA::TrackballManipulator * camera_man = new osgGA::TrackballManipulator();
-        camera_man->setHomePosition(config.camera_.look_from_,
-                                    config.camera_.look_at_,
-                                    config.camera_.up_);
-        camera_man->setAllowThrow(false); // disable spinning
-        camera_man->setVerticalAxisFixed(true);
-        viewer.setCameraManipulator(camera_man);
-
-
-        // enable screenshots if requested
-        osg::ref_ptr<SnapImageDrawCallback> snap_image_draw_callback = new SnapImageDrawCallback(
-                config.screenshot_filename_prefix_,
-                ".png");
-        if (config.enable_screenshots_)
-        {
-            viewer.getCamera()->setPostDrawCallback (snap_image_draw_callback.get());
-        }
-        viewer.getCamera()->setClearColor(config.background_color_); // background
-
-
-        viewer.realize();
-
-        bool stop_simulation = false;
-
-        for (std::ptrdiff_t iteration = 0; !viewer.done(); ++iteration)
-        {
-            // draw simple shapes
-            shapes_group->removeChildren(0, shapes_group->getNumChildren());
-            for (std::size_t i = 0; i < config.shapes_.size(); ++i)
-            {
-                config.shapes_[i]->draw(shapes_group, iteration);
-            }
-
-            // draw robots
-            for (std::size_t i = 0; i < robots.size(); ++i)
-            {
-                robots[i]->readStates();
-                if (robots[i]->file_stream_.eof() && (true == automatic_exit))
-                {
-                    stop_simulation = true;
-                }
-            }
-
-            if (true == stop_simulation)
-            {
-                break;
-            }
-
-            viewer.frame();
-
-            // for some reason this must follow a call to frame().
-            if (config.enable_screenshots_)
-            {
-                snap_image_draw_callback->snapImageOnNextFrame(iteration);
-            }
-
-            usleep(sleep_duration);
-        }
-    }
-    catch (const std::exception &e)
-    {
-        std::cout << e.what() << std::endl;
-    }
-
-    return 0;
-}
+/**
+    @file
+    @author  Alexander Sherikov
+    @copyright 2016-2017 INRIA. Licensed under the Apache License, Version 2.0.
+    (see LICENSE or http://www.apache.org/licenses/LICENSE-2.0)
+
+    @brief
+*/
+
+#include <osg/Node>
+#include <osg/Group>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Texture2D>
+#include <osgDB/ReadFile>
+#include <osgViewer/Viewer>
+#include <osg/PositionAttitudeTransform>
+#include <osgGA/TrackballManipulator>
+#include <osgGA/GUIEventHandler>
+
+#include <osg/Node>
+#include <osgDB/ReadFile>
+
+#include <osg/Camera>
+#include <osg/Viewport>
+#include <osg/GraphicsContext>
+#include <osg/BufferObject>
+#include <osg/GLExtensions>
+#include <osgDB/WriteFile>
+#include <osgUtil/Optimizer>
+#include <osgUtil/Simplifier>
+#include <osg/LOD>
+
+#include <osg/ShapeDrawable>
+
+#include <osg/LineWidth>
+
+#include <unistd.h>
+#include <stdio.h>
+#include <math.h>
+#include <sys/resource.h>
+#include <chrono>
+
+#include "image_writers.h"
+#include "tools.h"
+#include "drawing_functions.h"
+#include "pose_sources.h"
+#include "shape_data.h"
+#include "configuration.h"
+#include "mesh_cache.h"
+#include "scene_cache.h"
+#include "level_of_detail.h"
+#include "robots.h"
+#include "frame_pacer.h"
+#include "playback_control.h"
+
+void usage()
+{
+    printf("Options:\n");
+    printf("    -c 'configuration file' (required)\n");
+    printf("    -e (exit when the end of input file is reached)\n");
+    printf("    -d period (interval between displaying two configurations, ms)\n");
+    printf("    -t factor (real time factor of playback, default 1)\n");
+    printf("    -a (adaptive playback: skip displaying of late frames to hold real time, disabled with screenshots)\n");
+    printf("    -j iteration (start playback from the given iteration)\n");
+    printf("    -s use|off|rebuild (cache of robot scenes in '<robot description>.osgb', default 'use')\n");
+    printf("    -H (headless mode: render to an offscreen pbuffer, no window is opened)\n");
+    printf("    -p prefix (profile frames: write '<prefix>.json' (Chrome trace) and '<prefix>.csv')\n");
+    printf("    -r WIDTHxHEIGHT (resolution of the window or the offscreen buffer, default 1280x720 in headless mode)\n");
+}
+
+
+/**
+ * @brief Waits for the deadline of a frame, see FramePacer.
+ *
+ * @param[in] data_time time of the frame in the data [s]
+ */
+void waitForFrame(  FramePacer & frame_pacer,
+                    PlaybackControl & playback_control,
+                    const double data_time)
+{
+    if (playback_control.checkChanged())
+    {
+        frame_pacer.restart();
+    }
+
+    FrameProfiler::ScopedTimer timer(FrameProfiler::WAIT);
+
+    // deadlines must grow during backward playback as well
+    frame_pacer.waitForFrame(playback_control.getDirection() * data_time);
+}
+
+
+int main(int argc, char **argv)
+{
+    int option;
+
+    bool automatic_exit     = false;
+    char *config_file_name  = NULL;
+    double frame_period = 0.0;
+    double real_time_factor = 1.0;
+    bool frame_skipping = false;
+    std::ptrdiff_t start_iteration = 0;
+    std::string scene_cache_mode = "use";
+    bool headless = false;
+    int width = 0;
+    int height = 0;
+    std::string profile_prefix;
+
+    while ((option = getopt(argc, argv, "ec:d:t:aj:s:Hr:p:")) != -1)
+    {
+        switch (option)
+        {
+            case 'c':
+                config_file_name = optarg;
+                break;
+            case 'e':
+                automatic_exit = true;
+                break;
+            case 'd':
+                frame_period = strtod(optarg, NULL) / 1000.0;
+                break;
+            case 't':
+                real_time_factor = strtod(optarg, NULL);
+                if (real_time_factor <= 0.0)
+                {
+                    usage();
+                    return(0);
+                }
+                break;
+            case 'a':
+                frame_skipping = true;
+                break;
+            case 'j':
+                start_iteration = std::max(strtol(optarg, NULL, 10), 0L);
+                break;
+            case 's':
+                scene_cache_mode = optarg;
+                break;
+            case 'H':
+                headless = true;
+                break;
+            case 'r':
+                if (2 != sscanf(optarg, "%dx%d", &width, &height))
+                {
+                    usage();
+                    return(0);
+                }
+                break;
+            case 'p':
+                profile_prefix = optarg;
+                break;
+            case '?':
+            default:
+                usage();
+                return(0);
+        }
+    }
+
+
+
+    if (NULL == config_file_name)
+    {
+        usage();
+        return(0);
+    }
+    try
+    {
+        if (!profile_prefix.empty())
+        {
+            FrameProfiler::getInstance().enable();
+        }
+
+        Configuration config(config_file_name);
+
+
+        osg::ref_ptr<osg::Group> root = new osg::Group();
+
+        root->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::ON);
+        root->getOrCreateStateSet()->setMode(GL_LIGHT0, osg::StateAttribute::ON);
+        root->getOrCreateStateSet()->setMode(GL_NORMALIZE, osg::StateAttribute::ON);
+
+
+        std::vector<osg::ref_ptr<Robot> > robots;
+        osg::ref_ptr<MeshCache> mesh_cache = new MeshCache;
+
+        // poses of all robots are updated in one pass
+        osg::ref_ptr<robotDataType> robot_data = new robotDataType;
+        osg::ref_ptr<osg::Group> robots_group = new osg::Group;
+        robots_group->setUpdateCallback(new robotNodeCallback(robot_data));
+        root->addChild(robots_group.get());
+
+        // robot, whose timestamps drive playback
+        osg::ref_ptr<Robot> timestamp_robot;
+
+        for (std::size_t i = 0; i < config.robots_.size(); ++i)
+        {
+            osg::ref_ptr<Robot> robot = new Robot(mesh_cache, SceneCache::parseMode(scene_cache_mode), robot_data);
+            robot->load(  config.robots_[i].robot_description_file_,
+                          config.robots_[i].data_file_,
+                          config.prefetch_depth_,
+                          config.robots_[i].timestamp_column_,
+                          config.data_rate_,
+                          config.display_rate_);
+            robots_group->addChild(robot->robot_group_.get());
+
+            if (config.robots_[i].timestamp_column_ && !timestamp_robot.valid())
+            {
+                timestamp_robot = robot;
+            }
+
+            robots.push_back(robot);
+        }
+        mesh_cache->printStatistics();
+
+
+        drawGroundGrid(root);
+        drawFrame(root);
+
+
+        // define a group, which contains all simple shapes
+        osg::ref_ptr<osg::Group> shapes_group = new osg::Group();
+        root->addChild(shapes_group);
+
+        for (std::size_t i = 0; i < config.shapes_.size(); ++i)
+        {
+            config.shapes_[i]->build(shapes_group);
+        }
+
+
+
+        //The final step is to set up and enter a simulation loop.
+        osgViewer::Viewer viewer;
+        viewer.setSceneData( root );
+
+
+        // camera position
+        osgGA::TrackballManipulator * camera_man = new osgGA::TrackballManipulator();
+        camera_man->setHomePosition(config.camera_.look_from_,
+                                    config.camera_.look_at_,
+                                    config.camera_.up_);
+        camera_man->setAllowThrow(false); // disable spinning
+        camera_man->setVerticalAxisFixed(true);
+        viewer.setCameraManipulator(camera_man);
+
+
+        // enable screenshots if requested
+        osg::ref_ptr<SnapImageDrawCallback> snap_image_draw_callback;
+        if (config.enable_screenshots_)
+        {
+            osg::ref_ptr<ImageWriter> image_writer;
+
+            if ("y4m" == config.screenshot_output_)
+            {
+                image_writer = new VideoStreamWriter(   VideoStreamWriter::Y4M,
+                                                        config.screenshot_filename_prefix_ + "video",
+                                                        config.video_frame_rate_,
+                                                        config.screenshot_queue_depth_);
+            }
+            else if ("ffmpeg" == config.screenshot_output_)
+            {
+                image_writer = new VideoStreamWriter(   VideoStreamWriter::FFMPEG,
+                                                        config.screenshot_filename_prefix_ + "video",
+                                                        config.video_frame_rate_,
+                                                        config.screenshot_queue_depth_);
+            }
+            else
+            {
+                image_writer = new ImageFileWriter( config.screenshot_filename_prefix_,
+                                                    ".png",
+                                                    config.screenshot_encoder_threads_,
+                                                    config.screenshot_queue_depth_);
+            }
+
+            snap_image_draw_callback = new SnapImageDrawCallback(image_writer);
+            viewer.getCamera()->setPostDrawCallback (snap_image_draw_callback.get());
+        }
+        viewer.getCamera()->setClearColor(config.background_color_); // background
+
+
+        if (headless)
+        {
+            setUpOffscreenContext(viewer, width > 0 ? width : 1280, height > 0 ? height : 720);
+        }
+        else if ((width > 0) && (height > 0))
+        {
+            viewer.setUpViewInWindow(50, 50, width, height);
+        }
+
+        // keyboard control of playback requires random access to data
+        bool seekable = true;
+        for (std::size_t i = 0; i < robots.size(); ++i)
+        {
+            seekable = seekable && robots[i]->isSeekable();
+        }
+
+        osg::ref_ptr<PlaybackControl> playback_control = new PlaybackControl;
+        if (seekable)
+        {
+            viewer.addEventHandler(playback_control.get());
+        }
+        else if (start_iteration > 0)
+        {
+            throw std::runtime_error(std::string("In ") + __func__ + "() // " + ("Data sources do not support seeking."));
+        }
+
+
+        viewer.realize();
+
+        if (FrameProfiler::isEnabled())
+        {
+            enableRenderingStats(viewer);
+        }
+
+        bool stop_simulation = false;
+
+        // resampled data is displayed in real time by default
+        if ((frame_period <= 0.0) && config.isResampled())
+        {
+            frame_period = 1.0 / config.display_rate_;
+        }
+
+        const bool enable_pacing = (frame_period > 0.0) || timestamp_robot.valid();
+
+        if (frame_skipping && config.enable_screenshots_)
+        {
+            // every data frame must be exported
+            std::cout << "Frame skipping is disabled, since screenshots are enabled." << std::endl;
+            frame_skipping = false;
+        }
+        if (frame_skipping && !enable_pacing)
+        {
+            std::cout << "Frame skipping is disabled, since playback is not paced (see '-d' and timestamps)." << std::endl;
+            frame_skipping = false;
+        }
+        FramePacer frame_pacer(real_time_factor);
+
+        // data frame, which is read by the next call to Robot::readStates()
+        std::ptrdiff_t next_data_frame = 0;
+
+        // throughput of the main loop, see util/perf_check.py
+        std::size_t rendered_frame_number = 0;
+        const std::chrono::steady_clock::time_point loop_start = std::chrono::steady_clock::now();
+
+        for (std::ptrdiff_t iteration = start_iteration;
+                !viewer.done();
+                iteration = playback_control->getNextIteration(iteration))
+        {
+            FrameProfiler::getInstance().beginFrame(iteration);
+
+            const bool new_iteration = (iteration + 1 != next_data_frame);
+            bool skip_frame = false;
+
+            if (!new_iteration)
+            {
+                // the same frame is displayed again, e.g., during a pause
+                FrameProfiler::ScopedTimer timer(FrameProfiler::WAIT);
+                frame_pacer.waitIdle();
+            }
+            else if (enable_pacing && !timestamp_robot.valid())
+            {
+                // deadlines given by the period are known before reading, so
+                // late frames are skipped without parsing
+                waitForFrame(frame_pacer, *playback_control, iteration * frame_period);
+                skip_frame = frame_skipping && frame_pacer.isLate();
+            }
+
+            // draw robots
+            if (new_iteration)
+            {
+                for (std::size_t i = 0; i < robots.size(); ++i)
+                {
+                    if (iteration != next_data_frame)
+                    {
+                        robots[i]->seek(iteration);
+                    }
+                    if (skip_frame)
+                    {
+                        robots[i]->skipStates();
+                    }
+                    else
+                    {
+                        robots[i]->readStates();
+                    }
+                    if (robots[i]->eof() && (true == automatic_exit))
+                    {
+                        stop_simulation = true;
+                    }
+                }
+                next_data_frame = iteration + 1;
+            }
+
+            if (true == stop_simulation)
+            {
+                break;
+            }
+
+            // timestamps are known after reading, data of a late frame is
+            // consumed, but the scene is not updated
+            if (enable_pacing && timestamp_robot.valid() && new_iteration)
+            {
+                waitForFrame(frame_pacer, *playback_control, timestamp_robot->getTimestamp());
+                skip_frame = frame_skipping && frame_pacer.isLate();
+            }
+
+            if (skip_frame)
+            {
+                frame_pacer.skipFrame();
+                continue;
+            }
+
+            // show, hide or update simple shapes
+            {
+                FrameProfiler::ScopedTimer timer(FrameProfiler::SHAPES);
+                config.shape_timeline_.update(config.getDataFrame(iteration));
+            }
+
+            const FrameProfiler::Clock::time_point frame_begin = FrameProfiler::Clock::now();
+            viewer.frame();
+            ++rendered_frame_number;
+            if (FrameProfiler::isEnabled())
+            {
+                addRenderingTimes(viewer, frame_begin);
+            }
+
+            if (enable_pacing)
+            {
+                frame_pacer.finishFrame();
+            }
+
+            // for some reason this must follow a call to frame().
+            if (config.enable_screenshots_ && new_iteration)
+            {
+                snap_image_draw_callback->snapImageOnNextFrame(iteration);
+            }
+        }
+
+        FrameProfiler::getInstance().endFrame();
+
+        {
+            const double loop_duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - loop_start).count();
+
+            // kilobytes on Linux
+            struct rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+
+            std::cout << "Rendered " << rendered_frame_number << " frames in " << loop_duration << " s ("
+                      << (loop_duration > 0.0 ? rendered_frame_number / loop_duration : 0.0) << " frames/s), peak RSS "
+                      << usage.ru_maxrss / 1024.0 << " MB" << std::endl;
+        }
+
+        if (enable_pacing)
+        {
+            frame_pacer.printStatistics();
+        }
+
+
+        if (config.enable_screenshots_)
+        {
+            // pixels of the last snapshot are collected on the next frame
+            while (snap_image_draw_callback->isPending() && !viewer.done())
+            {
+                viewer.frame();
+            }
+            snap_image_draw_callback->finish();
+        }
+
+
+        for (std::size_t i = 0; i < robots.size(); ++i)
+        {
+            robots[i]->printStatistics();
+        }
+        for (std::size_t i = 0; i < config.shapes_.size(); ++i)
+        {
+            config.shapes_[i]->printStatistics();
+        }
+        if (config.shape_data_.valid())
+        {
+            config.shape_data_->printStatistics();
+        }
+
+        if (FrameProfiler::isEnabled())
+        {
+            FrameProfiler::getInstance().printSummary();
+            FrameProfiler::getInstance().writeChromeTrace(profile_prefix + ".json");
+            FrameProfiler::getInstance().writeCSV(profile_prefix + ".csv");
+            std::cout << "Saved frame profile to `" << profile_prefix << ".json` and `" << profile_prefix << ".csv`" << std::endl;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+# generates a synthetic scene of arbitrary size for performance tests:
+#   N robots with M bodies, whose meshes are procedural boxes,
+#   K shapes with time windows,
+#   text data files with T frames.
+# usage: generate_scene.py -o DIR [-n N] [-m M] [-k K] [-t T] [--seed S]
+# the scene is DIR/scene.yaml
+
+import argparse
+import math
+import os
+import random
+
+
+def write_box_mesh(filename, size):
+    # Wavefront OBJ box centered at the origin, faces with outward normals
+    x, y, z = [0.5 * s for s in size]
+
+    vertices = [(-x, -y, -z), (x, -y, -z), (x, y, -z), (-x, y, -z),
+                (-x, -y, z), (x, -y, z), (x, y, z), (-x, y, z)]
+    normals = [(0, 0, -1), (0, 0, 1), (0, -1, 0), (1, 0, 0), (0, 1, 0), (-1, 0, 0)]
+    faces = [(1, 4, 3, 2), (5, 6, 7, 8), (1, 2, 6, 5), (2, 3, 7, 6), (3, 4, 8, 7), (4, 1, 5, 8)]
+
+    with open(filename, 'w') as obj:
+        for v in vertices:
+            obj.write('v %f %f %f\n' % v)
+        for n in normals:
+            obj.write('vn %d %d %d\n' % n)
+        for i, f in enumerate(faces):
+            obj.write('f %d//%d %d//%d %d//%d\n' % (f[0], i + 1, f[1], i + 1, f[2], i + 1))
+            obj.write('f %d//%d %d//%d %d//%d\n' % (f[0], i + 1, f[2], i + 1, f[3], i + 1))
+
+
+def write_data_file(filename, robot, body_number, frame_number):
+    # bodies of a robot are placed on a grid and oscillate
+    side = int(math.ceil(math.sqrt(body_number)))
+    base_x = 3.0 * (robot % 10)
+    base_y = 3.0 * (robot // 10)
+
+    with open(filename, 'w') as data:
+        for frame in range(frame_number):
+            time = 0.01 * frame
+            values = []
+            for body in range(body_number):
+                phase = 0.1 * body + robot
+                values += [base_x + 0.3 * (body % side),
+                           base_y + 0.3 * (body // side),
+                           0.5 + 0.2 * math.sin(time + phase),
+                           0.3 * math.sin(0.5 * time + phase),
+                           0.3 * math.cos(0.5 * time + phase),
+                           math.fmod(time + phase, 2.0 * math.pi)]
+            data.write(' '.join('%.6f' % v for v in values) + '\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generates a synthetic scene for performance tests.')
+    parser.add_argument('-o', '--output', required=True, help='output directory')
+    parser.add_argument('-n', '--robots', type=int, default=10, help='number of robots')
+    parser.add_argument('-m', '--bodies', type=int, default=40, help='number of bodies of each robot')
+    parser.add_argument('-k', '--shapes', type=int, default=1000, help='number of shapes')
+    parser.add_argument('-t', '--frames', type=int, default=1000, help='number of frames in data files')
+    parser.add_argument('--seed', type=int, default=0, help='seed of the random number generator')
+    args = parser.parse_args()
+
+    random.seed(args.seed)
+
+    mesh_dir = os.path.join(args.output, 'meshes')
+    os.makedirs(mesh_dir, exist_ok=True)
+
+    # one mesh per body index, shared by the robots
+    for body in range(args.bodies):
+        size = [random.uniform(0.05, 0.25) for i in range(3)]
+        write_box_mesh(os.path.join(mesh_dir, 'box_%d.obj' % body), size)
+
+    with open(os.path.join(args.output, 'robot_description.yaml'), 'w') as description:
+        description.write('scale: 1.0\n')
+        description.write('ignore_body_rotation: false\n')
+        description.write('path_to_meshes: ./meshes/\n\n')
+        description.write('bodies:\n')
+        for body in range(args.bodies):
+            description.write('  - mesh_file: box_%d.obj\n' % body)
+            description.write('    name: body_%d\n' % body)
+
+    for robot in range(args.robots):
+        write_data_file(os.path.join(args.output, 'robot_%d.dat' % robot), robot, args.bodies, args.frames)
+
+    with open(os.path.join(args.output, 'scene.yaml'), 'w') as scene:
+        scene.write('enable_screenshots:         false\n')
+        scene.write('background_color:           [0., 0., 0.2, 0.0]\n\n')
+
+        scene.write('robots:\n')
+        for robot in range(args.robots):
+            scene.write('  - name:           robot_%d\n' % robot)
+            scene.write('    data_file:      robot_%d.dat\n' % robot)
+            scene.write('    robot_description: ./robot_description.yaml\n')
+
+        scene.write('\ncamera:\n')
+        scene.write('    look_from: [-5, -15., 10]\n')
+        scene.write('    look_at: [10, 5, 0]\n')
+        scene.write('    up: [0, 0, 1]\n')
+
+        scene.write('\nshapes:\n')
+        for shape in range(args.shapes):
+            position = '[%.3f, %.3f, %.3f]' % (random.uniform(-5, 30), random.uniform(-5, 30), random.uniform(0, 0.5))
+            color = '[%.2f, %.2f, %.2f, 1]' % (random.random(), random.random(), random.random())
+
+            # half of the shapes are always visible, others appear for a while
+            first_iter = 0
+            last_iter = -1
+            if shape % 2 == 1:
+                first_iter = random.randrange(args.frames)
+                last_iter = min(args.frames - 1, first_iter + random.randrange(1, max(2, args.frames // 4)))
+
+            kind = shape % 4
+            if kind == 0:
+                scene.write('  - type: box\n')
+                scene.write('    width: [0.2, 0.3, 0.1]\n')
+                scene.write('    rpy: [0, 0, %.3f]\n' % random.uniform(0, math.pi))
+            elif kind == 1:
+                scene.write('  - type: sphere\n')
+                scene.write('    radius: 0.1\n')
+            elif kind == 2:
+                scene.write('  - type: cylinder\n')
+                scene.write('    radius: 0.05\n')
+                scene.write('    length: 0.3\n')
+                scene.write('    rpy: [0, 0, 0]\n')
+            else:
+                scene.write('  - type: arrow\n')
+                scene.write('    vector: [0, 0, 0.3]\n')
+                scene.write('    vector_normalize: 1\n')
+            scene.write('    position: %s\n' % position)
+            scene.write('    color: %s\n' % color)
+            scene.write('    first_iter: %d\n' % first_iter)
+            scene.write('    last_iter: %d\n' % last_iter)
+
+    print('Generated %d robots with %d bodies, %d shapes, %d frames in `%s`'
+          % (args.robots, args.bodies, args.shapes, args.frames, os.path.join(args.output, 'scene.yaml')))
+
+
+if __name__ == '__main__':
+    main()
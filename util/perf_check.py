@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+# headless end-to-end performance check: generates a synthetic scene with
+# generate_scene.py, plays it back with the visualizer ('-e -H') and fails
+# if frames/s or peak RSS exceed the given thresholds.
+# usage: perf_check.py [--min-fps F] [--max-rss-mb R] [--record FILE] [scene size options]
+
+import argparse
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def main():
+    util_dir = os.path.dirname(os.path.abspath(__file__))
+
+    parser = argparse.ArgumentParser(description='Headless end-to-end performance check.')
+    parser.add_argument('--visualizer', default=os.path.join(util_dir, '..', 'build', 'osg-robot-visualizer'),
+                        help='visualizer binary (default build/osg-robot-visualizer)')
+    parser.add_argument('-n', '--robots', type=int, default=10, help='number of robots')
+    parser.add_argument('-m', '--bodies', type=int, default=40, help='number of bodies of each robot')
+    parser.add_argument('-k', '--shapes', type=int, default=1000, help='number of shapes')
+    parser.add_argument('-t', '--frames', type=int, default=1000, help='number of frames')
+    parser.add_argument('-r', '--resolution', default='640x480', help='resolution of the offscreen buffer')
+    parser.add_argument('--min-fps', type=float, default=0.0, help='fail if frames/s is lower (0: no check)')
+    parser.add_argument('--max-rss-mb', type=float, default=0.0, help='fail if peak RSS [MB] is higher (0: no check)')
+    parser.add_argument('--record', help='append results to the given CSV file')
+    parser.add_argument('--keep', action='store_true', help='keep the generated scene')
+    args = parser.parse_args()
+
+    scene_dir = tempfile.mkdtemp(prefix='osg-robot-visualizer-perf-')
+    try:
+        subprocess.check_call([sys.executable, os.path.join(util_dir, 'generate_scene.py'),
+                               '-o', scene_dir,
+                               '-n', str(args.robots), '-m', str(args.bodies),
+                               '-k', str(args.shapes), '-t', str(args.frames)])
+
+        command = [args.visualizer, '-c', os.path.join(scene_dir, 'scene.yaml'), '-e', '-H', '-r', args.resolution]
+        if 'DISPLAY' not in os.environ and shutil.which('xvfb-run') is not None:
+            command = ['xvfb-run', '-a'] + command
+
+        print(' '.join(command))
+        output = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                                universal_newlines=True).stdout
+    finally:
+        if args.keep:
+            print('Scene is kept in `%s`' % scene_dir)
+        else:
+            shutil.rmtree(scene_dir)
+
+    # the visualizer reports errors on stdout
+    match = re.search(r'Rendered (\d+) frames in ([0-9.]+) s \(([0-9.]+) frames/s\), peak RSS ([0-9.]+) MB', output)
+    if match is None:
+        print(output)
+        print('FAIL: no statistics in the output of the visualizer')
+        return 1
+
+    frames = int(match.group(1))
+    fps = float(match.group(3))
+    rss = float(match.group(4))
+    print('%d robots x %d bodies, %d shapes: %d frames, %.1f frames/s, peak RSS %.1f MB'
+          % (args.robots, args.bodies, args.shapes, frames, fps, rss))
+
+    if args.record is not None:
+        new_file = not os.path.exists(args.record)
+        with open(args.record, 'a') as record:
+            if new_file:
+                record.write('time,robots,bodies,shapes,frames,fps,peak_rss_mb\n')
+            record.write('%d,%d,%d,%d,%d,%.3f,%.3f\n'
+                         % (time.time(), args.robots, args.bodies, args.shapes, frames, fps, rss))
+
+    result = 0
+    if 0 == frames:
+        print('FAIL: no frames rendered')
+        result = 1
+    if (args.min_fps > 0.0) and (fps < args.min_fps):
+        print('FAIL: %.1f frames/s is below %.1f' % (fps, args.min_fps))
+        result = 1
+    if (args.max_rss_mb > 0.0) and (rss > args.max_rss_mb):
+        print('FAIL: peak RSS %.1f MB is above %.1f MB' % (rss, args.max_rss_mb))
+        result = 1
+
+    if 0 == result:
+        print('PASS')
+    return result
+
+
+if __name__ == '__main__':
+    sys.exit(main())